@@ -0,0 +1,58 @@
+#ifndef allocator_h
+#define allocator_h
+#include <c10/core/Allocator.h>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <vector>
+//- caching allocator for CPU tensors, the loss functions create dozens of
+//- temporaries of the same few sizes every step, freed blocks are kept in 
+//- free lists per (rounded) size and handed out again instead of going 
+//- through malloc/free, written against the c10::Allocator interface of
+//- libtorch >= 2.3
+class cachingCPUAllocator :
+  public c10::Allocator
+{
+  public:
+    //- constructor
+    cachingCPUAllocator(size_t maxCached);
+    //- allocate block, from the free lists if possible
+    c10::DataPtr allocate(size_t nbytes) override;
+    //- copy between two blocks of this allocator
+    void copy_data(void* dest, const void* src, std::size_t count) const override;
+    //- release all cached blocks back to the system
+    void emptyCache();
+    //- reset peak memory statistics
+    void resetPeak();
+    //- bytes currently handed out to tensors
+    size_t allocated() const;
+    //- peak of allocated bytes since the last reset
+    size_t peak() const;
+    //- bytes held in the free lists
+    size_t cached() const;
+    //- install as allocator for all CPU tensors, lives until the end of the run
+    static cachingCPUAllocator* install(size_t maxCached);
+    //- installed instance, nullptr if not installed
+    static cachingCPUAllocator* instance();
+  private:
+    //- block handed out to a tensor
+    struct block
+    {
+      void* ptr;
+      size_t size;
+    };
+    //- deleter of the DataPtr, returns block to the free lists
+    static void release(void* ctx);
+    //- return block to the free lists or free it if the cache is full
+    void free(block* b);
+    //- free blocks per size
+    std::map<size_t, std::vector<void*>> freeBlocks_;
+    //- upper bound of bytes kept in the free lists
+    size_t maxCached_;
+    size_t allocated_;
+    size_t peak_;
+    size_t cached_;
+    mutable std::mutex mutex_;
+};
+
+#endif // !allocator_h
@@ -0,0 +1,16 @@
+#ifndef benchmark_h
+#define benchmark_h
+#include <torch/torch.h>
+#include "config.h"
+#include "thermo.h"
+//- trains every architecture variant (activation x normalization, residual
+//- connections, Fourier features) for a fixed number of optimizer steps on 
+//- the first time window of the case and prints the time per step and the 
+//- final loss, so the architecture can be picked without recompiling
+void benchmarkArchitectures
+(
+  const caseConfig &config,
+  torch::Device &device,
+  thermoPhysical &thermo
+);
+#endif // !benchmark_h
@@ -37,6 +37,60 @@ torch::Tensor CahnHillard2D
 (
   const mesh2D &mesh
 );
+//- point-wise residuals of the governing equations at iPDE_,
+//- the losses above are the mean squares of these
+torch::Tensor R_Mass2D
+(
+  const mesh2D &mesh
+);
+torch::Tensor R_MomX2d
+(
+  const mesh2D &mesh
+);
+torch::Tensor R_MomY2d
+(
+  const mesh2D &mesh
+);
+torch::Tensor R_CahnHillard2D
+(
+  const mesh2D &mesh
+);
+//- chemical potential consistency of the mixed formulation
+torch::Tensor R_ChemPot2D
+(
+  const mesh2D &mesh
+);
+torch::Tensor L_ChemPot2D
+(
+  const mesh2D &mesh
+);
+//- finite difference versions of the residuals, evaluated from the 
+//- stencil fields of the mesh, selected per term with fdTerms
+bool fdTerm(const mesh2D &mesh, int term);
+torch::Tensor fdField(const mesh2D &mesh, int point, int comp);
+torch::Tensor fdD1(const mesh2D &mesh, int comp, int dim);
+torch::Tensor fdD2(const mesh2D &mesh, int comp, int dim);
+torch::Tensor fdLaplacian(const mesh2D &mesh, int comp, int point);
+torch::Tensor fdPhi(const mesh2D &mesh, int point);
+torch::Tensor R_Mass2D_FD(const mesh2D &mesh);
+torch::Tensor R_MomX2d_FD(const mesh2D &mesh);
+torch::Tensor R_MomY2d_FD(const mesh2D &mesh);
+torch::Tensor R_CahnHillard2D_FD(const mesh2D &mesh);
+torch::Tensor R_ChemPot2D_FD(const mesh2D &mesh);
+//- mean square of a tensor, loss against a zero target
+torch::Tensor meanSquare(const torch::Tensor &R);
+//- loss from a point-wise residual, plain mean square or causally weighted
+torch::Tensor residualLoss
+(
+  const mesh2D &mesh,
+  const torch::Tensor &R
+);
+//- causally weighted mean square of a point-wise residual
+torch::Tensor causalLoss
+(
+  const mesh2D &mesh,
+  const torch::Tensor &R
+);
 //- get thermoPhysical properties
 torch::Tensor thermoProp
 (
@@ -51,9 +105,30 @@ torch::Tensor ICloss(mesh2D &mesh);
 torch::Tensor slipWall(torch::Tensor &I,torch::Tensor &X, int dim);
 torch::Tensor noSlipWall(torch::Tensor &I, torch::Tensor &X);
 
+//- point-wise residuals of the boundary conditions
+std::vector<torch::Tensor> bcResiduals(mesh2D &mesh);
 torch::Tensor BCloss(mesh2D &mesh);
+//- residual of a PDE loss term (MASS, MOMX, MOMY, CH, MU)
+torch::Tensor pdeResidual(const mesh2D &mesh, int term);
+//- all point-wise residuals scaled so that their sum of squares is the loss
+torch::Tensor residualVector(mesh2D &mesh);
+//- indices of the individual loss terms returned by lossTerms
+enum lossTerm {MASS, MOMX, MOMY, CH, MU, BC, IC, NTERMS};
+//- name of a loss term for info out
+std::string lossTermName(int term);
+//- individual loss terms, ordered as in lossTerm, plain mean squares
+std::vector<torch::Tensor> lossTerms(mesh2D &mesh);
+//- plain loss terms for monitoring, trainTerms gets the terms to back 
+//- propagate (causally weighted PDE terms if enabled)
+std::vector<torch::Tensor> lossTerms
+(
+  mesh2D &mesh,
+  std::vector<torch::Tensor> &trainTerms
+);
 //- total loss function for the net
 torch::Tensor loss(mesh2D &mesh);
+//- total loss from the individual loss terms
+torch::Tensor loss(const std::vector<torch::Tensor> &terms);
 
 //- constrains C
 torch::Tensor Cbar(const torch::Tensor &C);
@@ -0,0 +1,119 @@
+#ifndef config_h
+#define config_h
+#include <string>
+#include <vector>
+#include "utils.h"
+//- schema entry of a configuration key
+struct configKey
+{
+  //- name of the key
+  std::string key;
+  //- type of the value, 'i' int, 'f' float, 's' string
+  char type;
+  //- missing required keys are an error
+  bool required;
+  //- default filled in for missing optional keys, empty for none
+  std::string defaultValue;
+  //- bounds for numeric values
+  double min;
+  double max;
+  //- allowed values for strings, empty for any
+  std::vector<std::string> choices;
+};
+
+//- typed thermoPhysical properties
+struct thermoConfig
+{
+  float Mo;
+  float epsilon;
+  float sigma0;
+  float rhoL;
+  float muL;
+  float rhoG;
+  float muG;
+  //- starting interface thickness of the continuation, 0 for none
+  float epsilonStart;
+  //- reduction factor of epsilon in each continuation stage
+  float epsilonFactor;
+};
+
+//- typed optimizer settings, learning rate decays by lRateDecay every 
+//- lRateEpochs epochs
+struct optimConfig
+{
+  float lRate;
+  float lRateDecay;
+  int lRateEpochs;
+};
+
+//- typed runtime settings
+struct runtimeConfig
+{
+  bool debug;
+  //- epochs between info out
+  int infoInterval;
+  //- epochs between intermediate saves of the fields
+  int saveInterval;
+  //- time the architecture variants instead of training
+  bool benchmark;
+  //- optimizer steps timed for each variant
+  int benchmarkSteps;
+  //- flag for the per epoch metrics log
+  bool metrics;
+  //- epochs between writes of the metrics log
+  int metricsFlush;
+  //- prefix of the metrics log files
+  std::string metricsFile;
+  //- flag for the auto-tuning of batch size and threads before training
+  bool autoTune;
+  //- optimizer steps timed for each candidate
+  int autoTuneSteps;
+  //- peak memory allowed for a candidate, 0 for no limit
+  int memoryBudgetMB;
+  //- file the tuned choices are recorded in
+  std::string autoTuneFile;
+};
+
+//- configuration of a case read from a single file with the sections
+//- [runtime], [mesh], [net], [thermo] and [optim], each holding key value 
+//- pairs, command line arguments section.key=value override the file, 
+//- every section is validated against its schema (unknown keys, missing 
+//- required keys, types, bounds) and defaults are filled in for optional
+//- keys, so nothing silently falls back to zero
+class caseConfig
+{
+  public:
+    //- read file (--case <file>, default ../case.txt) and apply overrides
+    caseConfig(int argc, char* argv[]);
+    //- print resolved configuration
+    void print() const;
+    //- validated section dictionaries passed on to the classes
+    Dictionary runtime;
+    Dictionary mesh;
+    Dictionary net;
+    Dictionary thermo;
+    Dictionary optim;
+    //- typed settings
+    runtimeConfig runtime_;
+    thermoConfig thermo_;
+    optimConfig optim_;
+  private:
+    //- returns section dictionary by name, nullptr if unknown
+    Dictionary* section(const std::string &name);
+    //- checks section against schema, fills in defaults, collects errors
+    void validate
+    (
+      const std::string &name,
+      Dictionary &dict,
+      const std::vector<configKey> &schema,
+      std::vector<std::string> &errors
+    );
+    //- name of the case file
+    std::string fileName_;
+    //- keys set from the command line (section.key)
+    std::vector<std::string> overrides_;
+    //- keys filled in from defaults (section.key)
+    std::vector<std::string> defaulted_;
+};
+
+#endif // !config_h
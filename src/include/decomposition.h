@@ -0,0 +1,138 @@
+#ifndef decomposition_h
+#define decomposition_h
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <torch/torch.h>
+#include "mesh.h"
+#include "pinn.h"
+#include "thermo.h"
+#include "utils.h"
+#include "config.h"
+using namespace torch::indexing;
+//- interface between two neighbouring sub-domains
+struct subDomainInterface
+{
+  //- index of the sub-domain on the lower side of the interface
+  int a;
+  //- index of the sub-domain on the upper side of the interface
+  int b;
+  //- 0 for interface at constant x, 1 for interface at constant y
+  int dim;
+  //- position of the interface
+  float position;
+  //- extent of the interface in the other spatial direction
+  float lb;
+  float ub;
+  //- sampled interface points (N x 3)
+  torch::Tensor points_;
+  //- frozen average of the predictions of both sides at the points
+  torch::Tensor target_;
+};
+
+//- sub-domain with its own net, collocation points and optimizer
+class subDomain
+{
+  public:
+    //- constructor
+    subDomain
+    (
+      Dictionary &meshDict,
+      Dictionary &netDict,
+      float lRate,
+      torch::Device &device,
+      thermoPhysical &thermo,
+      float lbX,
+      float ubX,
+      float lbY,
+      float ubY
+    );
+    //- one epoch of training including interface continuity losses,
+    //- returns the average loss
+    float trainEpoch
+    (
+      const std::vector<subDomainInterface> &interfaces,
+      int index,
+      float weight
+    );
+    //- current neural net instance
+    PinNet net_;
+    //- previous neural net instance
+    PinNet netPrev_;
+    //- mesh of the sub-domain, references the nets above
+    std::unique_ptr<mesh2D> mesh_;
+    //- optimizer for the sub-domain net
+    std::unique_ptr<torch::optim::Adam> optim_;
+    //- average loss of the last epoch
+    float loss_;
+};
+
+//- XPINN style decomposition of the (x,y) box into nSubX x nSubY 
+//- sub-domains, each with its own PinNet, coupled by continuity of the 
+//- solution across the interfaces, sub-domains train concurrently on 
+//- separate threads against frozen interface targets of the last epoch,
+//- the threads are started once and woken up for every epoch
+class domainDecomposition
+{
+  private:
+    //- loop of the worker thread of sub-domain s
+    void work(int s);
+    //- persistent worker threads, one per sub-domain
+    std::vector<std::thread> workers_;
+    //- synchronization of the epochs between main and worker threads
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    //- epoch counter, workers run once for every increment
+    int generation_ = 0;
+    //- number of sub-domains done with the current epoch
+    int nDone_ = 0;
+    //- set to shut the workers down
+    bool stop_ = false;
+  public:
+    //- constructor
+    domainDecomposition
+    (
+      Dictionary &meshDict,
+      Dictionary &netDict,
+      const optimConfig &optim,
+      torch::Device &device,
+      thermoPhysical &thermo
+    );
+    //- destructor, stops and joins the worker threads
+    ~domainDecomposition();
+    //- true if the domain is split into more than one sub-domain
+    bool active() const;
+    //- true while end time is not reached
+    bool running() const;
+    //- sample interface points and freeze targets from both sides
+    void sampleInterfaces();
+    //- one epoch for all sub-domains, returns the maximum loss
+    float trainEpoch();
+    //- advance all sub-domains to the next time window
+    void advance();
+    //- composite solution at the points X (N x 3)
+    torch::Tensor predict(const torch::Tensor &X);
+    //- number of sub-domains in x and y
+    int nSubX_;
+    int nSubY_;
+    //- bounds of the complete domain
+    float lbX_;
+    float ubX_;
+    float lbY_;
+    float ubY_;
+    //- end time of the simulation
+    float endTime_;
+    //- number of sample points on each interface
+    int nInterface_;
+    //- weight of the interface continuity losses
+    float interfaceWeight_;
+    //- sub-domains, index = i*nSubY_ + j
+    std::vector<std::unique_ptr<subDomain>> sub_;
+    //- interfaces between neighbouring sub-domains
+    std::vector<subDomainInterface> interfaces_;
+};
+
+#endif // !decomposition_h
@@ -4,6 +4,9 @@
 //- function to calculate higher order derivatives
 
 using namespace torch::indexing; 
+//- cached tensor of ones with the shape of I, grad output for d_d1
+const torch::Tensor &onesLike(const torch::Tensor &I);
+
 torch::Tensor d_dn
 (
   const torch::Tensor &I, // dependant scalar var
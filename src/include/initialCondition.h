@@ -0,0 +1,84 @@
+#ifndef initialCondition_h
+#define initialCondition_h
+#include <memory>
+#include <string>
+#include <torch/torch.h>
+#include "utils.h"
+using namespace torch::indexing;
+class mesh2D;
+//- base class for initial conditions of a time window, targets for the 
+//- solution fields (u, v, p, C) are evaluated once per window on the
+//- complete initial grid and gathered from that table during sampling
+class initialCondition
+{
+  public:
+    virtual ~initialCondition() = default;
+    //- returns targets (N x 4) at the points X (N x 3)
+    virtual torch::Tensor evaluate
+    (
+      const mesh2D &mesh,
+      const torch::Tensor &X
+    ) const = 0;
+};
+
+//- analytic bubble at rest, centered at (xc, yc)
+class analyticBubble :
+  public initialCondition
+{
+  public:
+    analyticBubble(float radius);
+    torch::Tensor evaluate
+    (
+      const mesh2D &mesh,
+      const torch::Tensor &X
+    ) const override;
+    //- radius of the bubble
+    float radius_;
+};
+
+//- converged net of the previous time window
+class previousNet :
+  public initialCondition
+{
+  public:
+    torch::Tensor evaluate
+    (
+      const mesh2D &mesh,
+      const torch::Tensor &X
+    ) const override;
+};
+
+//- field read in from file, e.g. produced by a conventional CFD solver,
+//- each row is x y u v p C on a structured (x, y) lattice, the targets 
+//- are interpolated bilinearly onto the initial grid
+class fieldFile :
+  public initialCondition
+{
+  public:
+    fieldFile
+    (
+      const std::string &fileName,
+      const torch::Device &device
+    );
+    torch::Tensor evaluate
+    (
+      const mesh2D &mesh,
+      const torch::Tensor &X
+    ) const override;
+    //- fields as image (1 x 4 x nY x nX)
+    torch::Tensor image_;
+    //- bounds of the lattice in the file
+    float lbX_;
+    float ubX_;
+    float lbY_;
+    float ubY_;
+};
+
+//- selects initial condition of the first window from the mesh dictionary
+std::shared_ptr<initialCondition> makeInitialCondition
+(
+  const Dictionary &dict,
+  const torch::Device &device
+);
+
+#endif // !initialCondition_h
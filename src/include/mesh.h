@@ -4,7 +4,20 @@
 #include "pinn.h"
 #include "utils.h"
 #include "thermo.h"
+#include "initialCondition.h"
+#include <map>
 using namespace torch::indexing; 
+//- points of the finite difference stencil around each PDE point, 
+//- offsets in units of the stencil spacing (x, y, t)
+enum stencilPoint 
+{
+  S_C,                              // ( 0, 0, 0)
+  S_XP, S_XM, S_YP, S_YM,           // (+-1, 0, 0), ( 0,+-1, 0)
+  S_X2P, S_X2M, S_Y2P, S_Y2M,       // (+-2, 0, 0), ( 0,+-2, 0)
+  S_XPYP, S_XPYM, S_XMYP, S_XMYM,   // (+-1,+-1, 0)
+  S_TP, S_TM,                       // ( 0, 0,+-1)
+  N_STENCIL
+};
 //- class to store in computational domain and solution fields
 class mesh2D :
   public torch::nn::Module
@@ -81,6 +94,9 @@ class mesh2D :
     torch::Tensor fieldsRight_;
     torch::Tensor fieldsTop_;
     torch::Tensor fieldsBottom_;
+    //- net output on the stencil of every PDE point (N_STENCIL x N x out),
+    //- only evaluated if residuals use finite differences
+    torch::Tensor fieldsStencil_;
     //- sampling points for PDE loss
     torch::Tensor iPDE_;
     torch::Tensor pdeIndices_;
@@ -88,6 +104,24 @@ class mesh2D :
     std::vector<torch::Tensor> initialGrid_;
     torch::Tensor iIC_;
     torch::Tensor icIndices_;
+    //- initial condition of the first time window
+    std::shared_ptr<initialCondition> firstIC_;
+    //- initial condition from netPrev_ for later time windows
+    std::shared_ptr<initialCondition> prevIC_;
+    //- start time of the simulation
+    float startTime_;
+    //- targets (u, v, p, C) on the complete initial grid, once per window
+    torch::Tensor icTable_;
+    //- targets gathered from icTable_ at the current IC samples
+    torch::Tensor icTarget_;
+    //- fraction of the PDE points placed in the interface band
+    float interfaceFraction_;
+    //- band is |C| < 1 - interfaceDelta_ at the start of the window
+    float interfaceDelta_;
+    //- flattened spatial indices of the lattice inside the interface band
+    torch::Tensor bandIndices_;
+    //- flattened copies of the grids, keyed by grid
+    std::map<const std::vector<torch::Tensor>*, torch::Tensor> flatGrids_;
     //- number of points in x direction 
     int Nx_;
     //- number of points in y direction
@@ -100,6 +134,14 @@ class mesh2D :
     int Ntotal_;
     //- time step for adaptive time marching 
     float TimeStep_;
+    //- flags for sides of the domain that are walls, false for 
+    //- interfaces between sub-domains
+    bool leftIsWall_;
+    bool rightIsWall_;
+    bool bottomIsWall_;
+    bool topIsWall_;
+    //- flag for the left side being the symmetry plane x = xc
+    bool leftIsSymmetry_;
     //- constructor
     mesh2D
     (
@@ -109,12 +151,27 @@ class mesh2D :
       torch::Device &device,
       thermoPhysical &thermo
     );
+    //- constructor for a sub-box of the domain
+    mesh2D
+    (
+      Dictionary &meshDict,
+      PinNet &net,
+      PinNet &netPrev,
+      torch::Device &device,
+      thermoPhysical &thermo,
+      float lbX,
+      float ubX,
+      float lbY,
+      float ubY
+    );
     //- operator overload to use index notation for access
     torch::Tensor operator()(int i,int j,int k);
     //- create boundary grids
     void createBC();
     //- after sub-net converges, upadate solution fields
     void update(int iter);
+    //- solution fields at the current samples
+    void forward();
     //- general function to create samples for neural net input
     void createSamples 
     (
@@ -129,13 +186,35 @@ class mesh2D :
       torch::Tensor &indices
     );
     void createIndices();
+    //- cached flattened copy (N x dim) of a grid
+    const torch::Tensor &flatGrid(const std::vector<torch::Tensor> &grid);
+    //- gather samples from a flattened grid into a reused tensor
+    void fillSamples
+    (
+      const torch::Tensor &flat,
+      torch::Tensor &samples,
+      const torch::Tensor &indices
+    );
     //-  creates total samples 
     void createTotalSamples
     (
       int iter //index for batch for pde
     );
+    //- single batched forward pass over the stencils of all PDE points
+    void updateStencil();
     //- update time parameters for next time interval
     void updateMesh();
+    //- move to the next time window [ubT_, ubT_ + stepSize], 
+    //- current net becomes the initial condition
+    void advanceWindow(float stepSize);
+    //- set bounds of the current time window and rebuild the grids
+    void setWindow(float lbT, float ubT);
+    //- evaluate initial condition targets on the complete initial grid
+    void updateICTable();
+    //- locate the interface band from the C column of icTable_
+    void updateInterfaceBand();
+    //- reconstruct the full domain from the half domain of a symmetric case
+    void mirror(torch::Tensor &grid, torch::Tensor &fields) const;
     void getOutputMesh();
 };
 
@@ -0,0 +1,64 @@
+#ifndef metrics_h
+#define metrics_h
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "config.h"
+//- records per epoch training metrics (total and per term losses, learning
+//- rate, step time, memory), records are kept in memory and appended to one
+//- CSV file per time window every flushInterval epochs, the losses are the
+//- host copies the epoch loop already has, so logging adds no device syncs
+class metricsLogger
+{
+  public:
+    //- constructor
+    metricsLogger(const runtimeConfig &config);
+    //- destructor, writes out what is left in the buffer
+    ~metricsLogger();
+    //- start the log of a time window
+    void open(float lbT, float ubT);
+    //- memory value of records without a measurement, written as n/a
+    static constexpr size_t noMemory = std::numeric_limits<size_t>::max();
+    //- append record of one epoch
+    void record
+    (
+      int epoch,
+      float loss,
+      const std::vector<float> &terms,
+      float lRate,
+      double stepTime,
+      size_t memory
+    );
+    //- write buffered records to file
+    void flush();
+    //- flush and close the log of the current window
+    void close();
+    //- flag for logging, 0 for false else true
+    int active_;
+    //- epochs between writes to file
+    int flushInterval_;
+    //- prefix of the log files
+    std::string prefix_;
+  private:
+    //- one epoch worth of metrics
+    struct record_
+    {
+      int epoch;
+      float loss;
+      std::vector<float> terms;
+      float lRate;
+      double stepTime;
+      size_t memory;
+    };
+    //- records not yet written
+    std::vector<record_> buffer_;
+    //- log of the current window
+    std::ofstream file_;
+    //- bounds of the window of the last log
+    float lbT_ = -1;
+    float ubT_ = -1;
+};
+
+#endif // !metrics_h
@@ -11,6 +11,20 @@ class  PinNetImpl:
     private:
         //- create and  register sub-modules with the main nn
         void create_layers();
+        //- initialize parameters of a linear layer with the init scheme
+        void init_layer(torch::nn::Linear &layer);
+        //- apply activation function
+        torch::Tensor activate(const torch::Tensor &X) const;
+        //- affine map of the input onto [-1,1] from the bounds of the domain
+        torch::Tensor normalize(const torch::Tensor &X) const;
+        //- Fourier feature embedding of the input, [X, sin(2 pi XB), cos(2 pi XB)]
+        torch::Tensor embed(const torch::Tensor &X) const;
+        //- multiply velocities with distance functions of the walls
+        torch::Tensor applyWalls
+        (
+          const torch::Tensor &X, 
+          const torch::Tensor &Y
+        ) const;
     //- public fields
     public:
         //- parametrized constructor
@@ -23,11 +37,41 @@ class  PinNetImpl:
         torch::Tensor forward(const torch::Tensor &X);
         //- resets all parameters in the network
         void reset_layers();
+        //- set bounds of the input normalization, called for every new window
+        void setInputBounds
+        (
+          const std::vector<float> &lb,
+          const std::vector<float> &ub
+        );
+        //- move parameters and floating point buffers into two flat
+        //- contiguous buffers, the tensors become views into them, must
+        //- be called after the net has been moved to its device
+        void flatten();
+        //- set box and wall sides used by the hard boundary constraints
+        void setWalls
+        (
+          float lbX, float ubX, float lbY, float ubY,
+          bool left, bool right, bool bottom, bool top
+        );
     //- public members
         //- Dictionary reference
         const Dictionary& dict;
-        // Sequential collection of hidden layers
-        torch::nn::Sequential hidden_layers;
+        //- hidden layers
+        std::vector<torch::nn::Linear> hidden_layers;
+        //- batch normalization layers after hidden layers
+        std::vector<torch::nn::BatchNorm1d> batchNorm_layers;
+        //- layer normalization layers after hidden layers
+        std::vector<torch::nn::LayerNorm> layerNorm_layers;
+        //- random Fourier feature matrix (FOURIER_FEATURES x INPUT_DIM)
+        torch::Tensor fourierB;
+        //- centre and inverse half width of the input bounds, buffers so
+        //- the previous net keeps the normalization it was trained with
+        torch::Tensor inputShift;
+        torch::Tensor inputScale;
+        //- flat storage of all parameters and floating point buffers, 
+        //- undefined until flatten() is called
+        torch::Tensor flatParameters;
+        torch::Tensor flatBuffers;
         //- input layer
         torch::nn::Linear input = nullptr; 
         //- output layer
@@ -60,6 +104,55 @@ class  PinNetImpl:
         //- flag for transient
         //- 0 for false else true
         int transient_;
+        //- flag for causal weighting of the PDE residuals in time
+        //- 0 for false else true
+        int causal_;
+        //- number of time bins for causal weighting
+        int N_CAUSAL_BINS;
+        //- causality parameter, larger values enforce stricter ordering
+        float CAUSAL_EPS;
+        //- flag for reusing input buffers between batches
+        //- 0 for false else true
+        int graphReuse_;
+        //- flag for flat parameter storage and the fused optimizer
+        //- 0 for false else true
+        int flatParams_;
+        //- flag for normalizing the inputs with the domain bounds
+        //- 0 for false else true
+        int normalizeInput_;
+        //- loss terms with finite difference residuals, comma separated 
+        //- names (Mass,MomX,MomY,CH,MU) or none
+        std::string FD_TERMS;
+        //- spatial and temporal spacing of the finite difference stencil,
+        //- default 1e-2 is near the float32 optimum eps^(1/4) of second 
+        //- differences, smaller h is dominated by roundoff eps/h^2 which 
+        //- the nested Laplacian of the CH residual amplifies further
+        float FD_H;
+        float FD_HT;
+        //- flag for the mixed formulation, chemical potential is output 4
+        //- 0 for false else true
+        int mixed_;
+        //- flag for enforcing the wall conditions on u and v by 
+        //- construction, 0 for false else true
+        int hardBC_;
+        //- box and wall sides of the hard boundary constraints
+        float wallLbX_, wallUbX_, wallLbY_, wallUbY_;
+        bool leftWall_ = false, rightWall_ = false;
+        bool bottomWall_ = false, topWall_ = false;
+        //- architecture spec, read in from Dictionary
+        //- activation function (silu, tanh, gelu, sin)
+        std::string ACTIVATION;
+        //- normalization after hidden layers (batchNorm, layerNorm, none)
+        std::string NORMALIZATION;
+        //- flag for residual connections around hidden layers
+        int residual_;
+        //- number of random Fourier features, 0 for none
+        int FOURIER_FEATURES;
+        //- standard deviation of the Fourier feature frequencies
+        float FOURIER_SCALE;
+        //- init scheme of the hidden layers 
+        //- (xavierNormal, xavierUniform, kaimingNormal, default)
+        std::string INIT;
         //- test 
         int test_;
         //- number of iterations in each epoch
@@ -0,0 +1,44 @@
+#ifndef residual_h
+#define residual_h
+#include <torch/torch.h>
+#include "mesh.h"
+#include "utils.h"
+using namespace torch::indexing;
+//- class to evaluate the PDE residuals over the complete mesh_ lattice
+//- (Nx*Ny*Nt points), the lattice is walked in tiles so that only one
+//- tile worth of higher order autograd graphs is alive at any time
+class residualEvaluator
+{
+  public:
+    //- constructor
+    residualEvaluator
+    (
+      mesh2D &mesh,
+      const Dictionary &dict
+    );
+    //- walk the lattice and populate the residual maps and norms
+    void evaluate();
+    //- residual map of a single equation reshaped to (Nx x Ny x Nt)
+    torch::Tensor residualField(int eqn) const;
+    //- write out x, y, t and residuals of all equations to file
+    void write(const std::string &fileName) const;
+    //- print out norms
+    void info() const;
+    //- reference to mesh
+    mesh2D &mesh_;
+    //- number of lattice points evaluated at once
+    int tileSize_;
+    //- number of equations (mass, momX, momY, CahnHillard and the chemical
+    //- potential in the mixed formulation)
+    int nEqn_;
+    //- lattice points (Ntotal x 3) the residuals were evaluated on
+    torch::Tensor grid_;
+    //- residual maps, one column for each equation (Ntotal x nEqn)
+    torch::Tensor residualMap_;
+    //- root mean square of each residual over the lattice
+    std::vector<float> L2_;
+    //- maximum absolute value of each residual over the lattice
+    std::vector<float> Linf_;
+};
+
+#endif // !residual_h
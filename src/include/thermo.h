@@ -1,11 +1,14 @@
 #ifndef thermo_h
 #define thermo_h
 #include "utils.h"
+#include "config.h"
 class thermoPhysical
 {
   public:
     //- constructor reads in properties from file
     thermoPhysical(Dictionary &dict);
+    //- constructor from validated case configuration
+    thermoPhysical(const thermoConfig &config);
     //- mobility
     float Mo;
     //- interface thickness
@@ -1,5 +1,299 @@
 #ifndef train_h
 #define train_h
 //- Training sub-routines for PINNs
+#include <deque>
+#include <string>
+#include <vector>
+#include <torch/torch.h>
+#include "utils.h"
+#include "mesh.h"
+#include "config.h"
+
+//- controls the epoch budget of a time window, tracks an exponentially
+//- smoothed loss and its relative improvement over a window of epochs,
+//- ends the time window early on stagnation and extends the budget while
+//- the loss is still dropping quickly
+class convergenceControl
+{
+  public:
+    //- constructor, reads in controls from params dictionary
+    convergenceControl
+    (
+      const Dictionary &dict
+    );
+    //- reset history and budget at the start of a time window
+    void reset();
+    //- update with the average total and per-term losses of an epoch
+    void update
+    (
+      int epoch,
+      float loss,
+      const std::vector<float> &terms
+    );
+    //- returns true if the epoch loop should continue
+    bool running(int epoch) const;
+    //- print out state of the controller
+    void info() const;
+    //- flag to turn controller on, else fixed budget of K_EPOCH
+    int active_;
+    //- smoothing factor for the exponential moving average
+    float alpha_;
+    //- number of epochs the improvement rate is measured over
+    int window_;
+    //- no early stopping before this epoch
+    int minEpoch_;
+    //- relative improvement over window below which the window stalls
+    float stallRate_;
+    //- relative improvement over window above which the budget is extended
+    float extendRate_;
+    //- default epoch budget (K_EPOCH)
+    int baseBudget_;
+    //- upper bound of the epoch budget including extensions
+    int maxBudget_;
+    //- current epoch budget
+    int budget_;
+    //- smoothed loss
+    float smoothLoss_;
+    //- relative improvement of smoothed loss over the last window
+    float rate_;
+    //- per-term share of the total loss
+    std::vector<float> ratios_;
+    //- history of smoothed loss over the last window
+    std::deque<float> history_;
+    //- flag set once the loss stagnates
+    bool stalled_;
+};
+
+//- per-term loss weighting, the weights of the terms returned by
+//- CahnHillard::lossTerms are either fixed or adapted from the gradients
+//- of the individual terms wrt the network parameters:
+//-   annealing: learning rate annealing, w_k = max|grad L_ref|/mean|grad L_k|
+//-   gradNorm : equalize gradient norms, w_k = mean_j|grad L_j|_2/|grad L_k|_2
+//- adapted weights are relaxed with an exponential moving average
+class lossBalancer
+{
+  public:
+    //- constructor, reads in method and per-term weights from params dictionary
+    lossBalancer
+    (
+      const Dictionary &dict
+    );
+    //- returns true if the weights are to be updated in this epoch
+    bool due(int epoch) const;
+    //- weighted total loss
+    torch::Tensor weightedLoss(const std::vector<torch::Tensor> &terms) const;
+    //- update weights from the gradients of each term wrt parameters,
+    //- graph of the terms is retained for the subsequent backward pass
+    void update
+    (
+      const std::vector<torch::Tensor> &terms,
+      const std::vector<torch::Tensor> &params
+    );
+    //- print out current weights
+    void info() const;
+    //- weighting method (none, annealing, gradNorm)
+    std::string method_;
+    //- update weights every updateFreq_ epochs
+    int updateFreq_;
+    //- relaxation factor for weight updates
+    float alpha_;
+    //- reference term for annealing
+    int refTerm_;
+    //- current weight of each term
+    std::vector<float> weights_;
+    //- flags for terms with adaptive weights
+    std::vector<int> adaptive_;
+};
+
+//- collocation curriculum within a time window, an epoch starts out with
+//- a fraction of the N_EQN PDE points (whole batches) and the number of 
+//- points grows by a factor every fixed number of epochs or earlier once 
+//- the loss plateaus, until the configured N_EQN is reached
+class collocationCurriculum
+{
+  public:
+    //- constructor, reads in schedule from params dictionary
+    collocationCurriculum
+    (
+      const Dictionary &dict
+    );
+    //- start a time window with the smallest budget of points
+    void reset(PinNet &net);
+    //- update with the loss of an epoch, grows the points of the net
+    void update(int epoch, float loss, PinNet &net);
+    //- true once all N_EQN points are in use
+    bool complete() const;
+    //- print out current number of points
+    void info() const;
+    //- flag for the curriculum, else N_EQN points in every epoch
+    int active_;
+    //- configured number of PDE points and batch size
+    int maxEqn_;
+    int batchSize_;
+    //- fraction of maxEqn_ in the first epochs
+    float startFraction_;
+    //- growth factor of the number of points
+    float growFactor_;
+    //- epochs between growths
+    int growEpochs_;
+    //- relative improvement below which the loss counts as a plateau
+    float stallRate_;
+    //- epochs without improvement that trigger growth
+    int patience_;
+    //- current number of points
+    int nEqn_;
+    //- epoch of the last growth
+    int lastGrowth_;
+    //- best loss since the last growth and epochs since it improved
+    float bestLoss_;
+    int sinceBest_;
+  private:
+    //- set points and iterations of the net, whole batches only
+    void apply(PinNet &net);
+};
+
+//- interface thickness continuation, the first window is trained with a
+//- thicker interface epsilonStart that is reduced by epsilonFactor after 
+//- every training of the window down to the target epsilon, the net keeps
+//- its weights between the stages so every stage starts from the solution
+//- of the thicker interface
+class epsilonContinuation
+{
+  public:
+    //- constructor, reads in schedule from the thermo settings and sets 
+    //- the starting thickness
+    epsilonContinuation
+    (
+      const thermoConfig &thermo,
+      mesh2D &mesh
+    );
+    //- thin the interface after a window is trained, returns true if the 
+    //- window has to be trained again with the new thickness
+    bool next(mesh2D &mesh);
+    //- flag for continuation
+    int active_;
+    //- target interface thickness
+    float target_;
+    //- reduction factor of each stage
+    float factor_;
+};
+
+//- Adam on the flat parameter buffer of a PinNet (PinNetImpl::flatten), 
+//- moments are flat as well so a step is a handful of kernels on one
+//- contiguous tensor instead of a dozen per parameter tensor
+class fusedAdam :
+  public torch::optim::Optimizer
+{
+  public:
+    //- constructor, net must have been flattened
+    fusedAdam
+    (
+      PinNet &net,
+      const torch::optim::AdamOptions &options
+    );
+    //- gather gradients and update the flat buffer
+    torch::Tensor step(LossClosure closure = nullptr) override;
+  private:
+    //- flat parameter buffer of the net
+    torch::Tensor flat_;
+    //- flat gradient, first and second moments
+    torch::Tensor grad_;
+    torch::Tensor m_;
+    torch::Tensor v_;
+    //- number of steps taken, for bias correction
+    int64_t nSteps_;
+};
+
+//- Adam with the given learning rate, fused if the net is flattened
+std::unique_ptr<torch::optim::Optimizer> makeAdam(PinNet &net, float lr);
+
+//- Levenberg-Marquardt optimizer for small nets, the Jacobian J of the 
+//- point-wise residual vector (CahnHillard::residualVector) wrt the 
+//- parameters is assembled column by column with the double backward trick
+//- (J v = d/du (J^T u . v), one backward pass per parameter instead of one
+//- per residual), the damped normal equations 
+//-   (J^T J + lambda diag(J^T J)) dp = -J^T r
+//- are solved densely, steps that do not reduce the loss are rejected and
+//- the damping is raised, one step per epoch on the first batch
+class levenbergMarquardt
+{
+  public:
+    //- constructor, reads in damping controls from params dictionary
+    levenbergMarquardt
+    (
+      const Dictionary &dict
+    );
+    //- one step, returns the loss terms of the new state
+    std::vector<torch::Tensor> step(mesh2D &mesh);
+    //- back to the initial damping at the start of each time window
+    void reset();
+    //- flag for LM instead of Adam
+    int active_;
+    //- damping parameter, kept within [1e-12, 1e12]
+    float lambda_;
+    //- initial damping of each window
+    float lambda0_;
+    //- factors applied to lambda after rejected and accepted steps
+    float up_;
+    float down_;
+    //- maximum number of trial steps per call
+    int maxTries_;
+  private:
+    //- Jacobian (M x P) of the residual vector r wrt the parameters
+    torch::Tensor jacobian
+    (
+      const torch::Tensor &r,
+      const std::vector<torch::Tensor> &params
+    ) const;
+    //- add a flat step to the parameters
+    void addStep
+    (
+      const std::vector<torch::Tensor> &params,
+      const torch::Tensor &delta
+    ) const;
+};
+
+//- adaptive sizing of the time windows in the time marching loop, a window
+//- is rejected and retried with a smaller step if training does not reach
+//- the target loss or the initial condition loss wrt netPrev_ stays large,
+//- the step grows when windows converge quickly
+class timeMarching
+{
+  public:
+    //- constructor, reads in controls from mesh dictionary
+    timeMarching
+    (
+      const Dictionary &dict,
+      const mesh2D &mesh
+    );
+    //- returns true while end time is not reached
+    bool running(const mesh2D &mesh) const;
+    //- judge trained window, returns false if the window has to be retried
+    bool accept
+    (
+      bool converged,
+      int epochs,
+      int budget,
+      float icLoss
+    );
+    //- move mesh to the next time window
+    void advance(mesh2D &mesh) const;
+    //- flag for adaptive window size, else fixed stepSize
+    int adaptive_;
+    //- end time of the simulation
+    float endTime_;
+    //- current window size
+    float step_;
+    //- bounds for window size
+    float minStep_;
+    float maxStep_;
+    //- factors to grow and shrink the window size
+    float growFactor_;
+    float shrinkFactor_;
+    //- windows converged within this fraction of the budget grow the step
+    float fastFraction_;
+    //- tolerance on the initial condition loss
+    float icTol_;
+};
 
 #endif
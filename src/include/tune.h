@@ -0,0 +1,17 @@
+#ifndef tune_h
+#define tune_h
+#include <torch/torch.h>
+#include "config.h"
+//- picks BATCHSIZE and the number of intra-op threads before training,
+//- every candidate runs a few timed epochs of the real batch loop (mesh2D::update, loss, backward over all
+//- batches and one optimizer step, as in the closure of main), the 
+//- fastest candidate in PDE points per second whose peak memory stays 
+//- within the budget is written into the [net] section, the choice is 
+//- recorded in a file keyed by hardware and everything that sets the cost
+//- of a step and reused on the next run with the same key
+void autoTune
+(
+  caseConfig &config,
+  torch::Device &device
+);
+#endif // !tune_h
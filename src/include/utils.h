@@ -110,6 +110,9 @@ void writeOut(std::string fileName, std::vector<std::vector<T>> vec,const char d
 class Dictionary 
 {
   public:
+    //- empty Dictionary, populated with set
+    Dictionary()
+    {}
     Dictionary(std::string fileName)
     {
       readFromFile(fileName);
@@ -138,6 +141,45 @@ class Dictionary
       }
       return ValueType(); // Default value if key not found or conversion fails
     }
+
+    // function to get value from Dictionary, returns defaultValue if the 
+    // key is not present (used for optional switches)
+    template <typename ValueType>
+    ValueType lookupOrDefault
+    (
+      const std::string& key, 
+      const ValueType& defaultValue
+    ) const 
+    {
+      auto it = data.find(key);
+      if (it != data.end()) 
+      {
+        ValueType result;
+        std::istringstream iss(it->second);
+        if (iss >> result)
+        {
+          return result;
+        }
+      }
+      return defaultValue;
+    }
+
+    // all keys present in the Dictionary
+    std::vector<std::string> keys() const
+    {
+      std::vector<std::string> result;
+      for(const auto &entry : data)
+      {
+        result.push_back(entry.first);
+      }
+      return result;
+    }
+
+    // check if key is present in Dictionary
+    bool found(const std::string& key) const
+    {
+      return data.find(key) != data.end();
+    }
     
     // Function to read key-value pairs from a file
     void readFromFile(const std::string& filename) 
@@ -7,6 +7,7 @@
 #include <c10/core/TensorOptions.h>
 #include <fstream>
 #include <iostream>
+#include <numeric>
 #include <string>
 #include <torch/csrc/autograd/autograd.h>
 #include <torch/csrc/jit/api/module.h>
@@ -17,6 +18,14 @@
 #include "./include/mesh.h"
 #include "./include/derivatives.h"
 #include "./include/ch.h"
+#include "./include/residual.h"
+#include "./include/train.h"
+#include "./include/decomposition.h"
+#include "./include/allocator.h"
+#include "./include/config.h"
+#include "./include/benchmark.h"
+#include "./include/metrics.h"
+#include "./include/tune.h"
 //- loads in python like indexing of tensors
 using namespace torch::indexing;
 
@@ -108,9 +117,11 @@ void writeTensorToFile(torch::Tensor& tensor, torch::Tensor& additionalTensor, c
 int main(int argc,char * argv[])
 {
   std::cout<<"from new src::\n";
+  //- read in and validate the case configuration, apply command line overrides
+  caseConfig config(argc,argv);
+  config.print();
   // define debug level
-  Dictionary debugDict = Dictionary("../debug.txt");
-  bool debug = debugDict.get<bool>("DEBUG");
+  bool debug = config.runtime_.debug;
   debugMode = debug;
   if(debugMode)
     std::cout<<"debug is: "<<debug<<"\n";
@@ -124,7 +135,20 @@ int main(int argc,char * argv[])
   
   //- create common Dictionary for both nets
   //- both nets share the same architecture, only network params update
-  Dictionary netDict = Dictionary("../params.txt");
+  Dictionary &netDict = config.net;
+  
+  //- recycle the per step temporaries on the CPU instead of hitting malloc
+  if(!cuda_available && netDict.lookupOrDefault<int>("arenaAllocator",0))
+  {
+    size_t maxCachedMB = netDict.lookupOrDefault<int>("arenaMaxMB",1024);
+    cachingCPUAllocator::install(maxCachedMB << 20);
+  }
+  
+  //- pick batch size and threads before the nets read them
+  if(config.runtime_.autoTune)
+  {
+    autoTune(config,device);
+  }
   
   //- create first net primary net, is the one being trained
   auto net1 = PinNet(netDict);
@@ -135,11 +159,15 @@ int main(int argc,char * argv[])
   net1->to(device);
   net2->to(device);
   //- create dict for mesh
-  Dictionary meshDict = Dictionary("../mesh.txt");
-  //- create dict for thermoPhysical class
-  Dictionary thermoDict = Dictionary("../thermo.txt");
+  Dictionary &meshDict = config.mesh;
   //- create thermoPhysical object
-  thermoPhysical thermo(thermoDict);
+  thermoPhysical thermo(config.thermo_);
+  //- time the architecture variants and exit
+  if(config.runtime_.benchmark)
+  {
+    benchmarkArchitectures(config,device,thermo);
+    return 0;
+  }
   //- create Mesh
   mesh2D mesh(meshDict,net1,net2,device,thermo);
   // torch::Tensor testLoss = CahnHillard::PDEloss(mesh);
@@ -166,52 +194,133 @@ int main(int argc,char * argv[])
     mesh.update(1);
   }
 
-  //- TODO intialize optim paras from dictionary to avoid recompilation 
+  //- domain decomposition, every sub-domain trains its own net
+  domainDecomposition decomposition(meshDict,netDict,config.optim_,device,thermo);
+  if(decomposition.active())
+  {
+    //- Time marching loop
+    while(decomposition.running())
+    {
+      std::cout<<"Traning sub-domains...\n";
+      int iter = 1;
+      float loss = 0.0;
+      //- epoch loop, converged once every sub-domain reaches the target
+      while(iter <= mesh.net_->K_EPOCH)
+      {
+        decomposition.sampleInterfaces();
+        loss = decomposition.trainEpoch();
+        if (iter % config.runtime_.infoInterval == 0) 
+        { 
+          std::cout << "  iter=" << iter << ", max loss=" << std::setprecision(7) << loss<<"\n";
+        }
+        iter += 1;
+        if (loss < mesh.net_->ABS_TOL) 
+        {
+          break;
+        }
+      }
+      //- composite solution on the complete grid at the end of the window
+      float ubT = decomposition.sub_[0]->mesh_->ubT_;
+      torch::Tensor grid = torch::stack
+      (
+        {
+          torch::flatten(mesh.xyGrid[0]),
+          torch::flatten(mesh.xyGrid[1]),
+          torch::full_like(torch::flatten(mesh.xyGrid[1]),ubT) //time values 
+        },1
+      );
+      torch::Tensor C1 = decomposition.predict(grid);
+      writeTensorToFile(grid,"grid" + std::to_string(ubT));
+      writeTensorToFile(C1,"fields" + std::to_string(ubT)); 
+      decomposition.advance();
+    }
+    return 0;
+  }
+
   //- declare optimizer instance to be used in training
   //- learning rate is decreased over the traning process and the optimizer class instance is changed
-  torch::optim::Adam adam_optim1(mesh.net_->parameters(), torch::optim::AdamOptions(1e-3));  
-  torch::optim::Adam adam_optim2(mesh.net_->parameters(), torch::optim::AdamOptions(1e-4)); 
-  torch::optim::Adam adam_optim3(mesh.net_->parameters(), torch::optim::AdamOptions(1e-5));
+  const optimConfig &optimSettings = config.optim_;
+  const float lr1 = optimSettings.lRate;
+  const float lr2 = lr1*optimSettings.lRateDecay;
+  const float lr3 = lr2*optimSettings.lRateDecay;
+  //- fused Adam on the flat parameter buffer if flatParams is set
+  auto adam_optim1 = makeAdam(mesh.net_,lr1);
+  auto adam_optim2 = makeAdam(mesh.net_,lr2);
+  auto adam_optim3 = makeAdam(mesh.net_,lr3);
+
 
+  //- controls the epoch budget of each time window
+  convergenceControl control(netDict);
+  //- per term weights of the loss function
+  lossBalancer balancer(netDict);
+  //- controls the size of the time windows
+  timeMarching marching(meshDict,mesh);
+  //- per epoch loss history, one file per window
+  metricsLogger metrics(config.runtime_);
+  //- grows the number of PDE points within each window
+  collocationCurriculum curriculum(netDict);
+  //- thick to sharp interface in the first window
+  epsilonContinuation continuation(config.thermo_,mesh);
+  //- second order optimizer for small nets, replaces Adam if selected
+  levenbergMarquardt lm(netDict);
 
   // Put info statement here
 
   //- Time marching loop
-  for(int N=0;N<3;N++)
+  int N = 0;
+  while(marching.running(mesh))
   {
     //- set up epoch loop
     int iter=1;
     float loss;
+    control.reset();
+    curriculum.reset(mesh.net_);
+    lm.reset();
+    //- per term losses of the current epoch, accumulated on device
+    std::vector<torch::Tensor> epochTerms(CahnHillard::NTERMS);
+    //- per term losses of the last epoch
+    std::vector<float> lastTerms(CahnHillard::NTERMS,0.0);
 
     //- file to print out loss history
+    metrics.open(mesh.lbT_,mesh.ubT_);
     std::cout<<"Traning...\n";
     
     //- start profile clock
     auto start_time = std::chrono::high_resolution_clock::now();
     //- epoch loop
-    while(iter<=mesh.net_->K_EPOCH)
+    while(control.running(iter))
     {
       //- define closure for optimizer class to work with
       auto closure = [&](torch::optim::Optimizer &optim)
       { 
-        float totalLoss=0.0;
         for(int i=0;i<mesh.net_->NITER_;i++)
         {
           //- generate solution fields from forward pass, accumulate gradients
           mesh.update(i);
-          //- get total loss for the optimizer (PDE,IC,BC)
-          auto loss = CahnHillard::loss(mesh);
+          //- get individual and total loss for the optimizer (PDE,IC,BC),
+          //- only the back propagated terms are causally weighted, the 
+          //- plain terms go to the controllers, the stop test and the log
+          std::vector<torch::Tensor> trainTerms;
+          auto terms = CahnHillard::lossTerms(mesh,trainTerms);
+          //- adapt loss weights on the first batch of the epoch
+          if(i == 0 && balancer.due(iter))
+          {
+            balancer.update(trainTerms,mesh.net_->parameters());
+          }
+          auto loss = balancer.weightedLoss(trainTerms);
           //- back propogate and accumulate gradiets of loss wrt to parameters
           loss.backward();
-          //- get the total loss across all iterations within the epoch
-          totalLoss +=loss.item<float>();
+          //- accumulate the individual terms without a host sync per term
+          for(int k=0;k<CahnHillard::NTERMS;k++)
+          {
+            epochTerms[k] = 
+              (i == 0) ? terms[k].detach() : epochTerms[k] + terms[k].detach();
+          }
         }
         //- update network parameters
         optim.step();
         //- clear gradients for next batch iteration
         optim.zero_grad();
-        //- return the average loss
-        return totalLoss/mesh.net_->NITER_;
       };
 
       //- print out iteration numbers
@@ -220,28 +329,67 @@ int main(int argc,char * argv[])
         std::cout<<iter<<"\n";
       }
 
-      //- TODO make it more general by making it a Dict 
-      //  and making all the other parameters as dicts as well
+      auto step_start = std::chrono::high_resolution_clock::now();
       //- learning rate schedule
-      if (iter <= 4000)
+      float lr;
+      //- batches the epoch terms are accumulated over
+      int nBatches = mesh.net_->NITER_;
+      if(lm.active_)
+      {
+        //- damping reported in place of the learning rate
+        lr = lm.lambda_;
+        epochTerms = lm.step(mesh);
+        nBatches = 1;
+      }
+      else if (iter <= optimSettings.lRateEpochs)
       {
-        loss = closure(adam_optim1);
+        lr = lr1;
+        closure(*adam_optim1);
       } 
-      else if(iter <= 8000) 
+      else if(iter <= 2*optimSettings.lRateEpochs) 
       { 
-        loss = closure(adam_optim2);
+        lr = lr2;
+        closure(*adam_optim2);
       }
       else
       {
-        loss = closure(adam_optim3);
+        lr = lr3;
+        closure(*adam_optim3);
       }
       
+      //- epoch averages of the terms, the only host sync of the epoch
+      torch::Tensor termsHost = 
+        (torch::stack(epochTerms)/nBatches).to(torch::kCPU);
+      std::vector<float> terms
+      (
+        termsHost.data_ptr<float>(),
+        termsHost.data_ptr<float>() + CahnHillard::NTERMS
+      );
+      //- total (unweighted) loss averaged over the iterations of the epoch
+      loss = std::accumulate(terms.begin(),terms.end(),0.0f);
+      auto step_end = std::chrono::high_resolution_clock::now();
+      metrics.record
+      (
+        iter,
+        loss,
+        terms,
+        lr,
+        std::chrono::duration<double,std::milli>(step_end - step_start).count(),
+        //- only the arena allocator tracks its memory
+        cachingCPUAllocator::instance() ? 
+          cachingCPUAllocator::instance()->allocated() : metricsLogger::noMemory
+      );
+      //- update convergence controller with the epoch averages
+      control.update(iter,loss,terms);
+      curriculum.update(iter,loss,mesh.net_);
+      lastTerms = terms;
+
       // TODO
       //- make a dict for all of this, do not recompile the code every time you change something trivial
 
       //- info out to terminal
-      //- does not work on the cluster for some reason, rely on the loss.txt for info
-      if (iter % 10 == 0) 
+      //- does not work on the cluster for some reason, rely on the metrics files for info
+      if (iter % config.runtime_.infoInterval == 0) 
       { 
         if(N !=0)
         {
@@ -260,9 +408,12 @@ int main(int argc,char * argv[])
         }// lossFile<<iter<<" "<<loss<<"\n";
       
 
-        std::cout << "  iter=" << iter << ", loss=" << std::setprecision(7) << loss<<" lr: "<<adam_optim1.defaults().get_lr()<<"\n";
+        std::cout << "  iter=" << iter << ", loss=" << std::setprecision(7) << loss<<" lr: "<<lr<<"\n";
+        control.info();
+        balancer.info();
+        curriculum.info();
       }
-      if(iter % 5000 == 0)
+      if(iter % config.runtime_.saveInterval == 0)
       {
         std::cout<<"saving output..."<<"\n";
         std::string modelName = "pNetSave" + std::to_string(mesh.ubT_);
@@ -280,6 +431,8 @@ int main(int argc,char * argv[])
 
         //- get predicted output, and from that get phaseField 
         torch::Tensor C1 = mesh.net_->forward(grid);
+        //- full domain of a symmetric case
+        mesh.mirror(grid,C1);
         std::string gridName = "gridSave" + std::to_string(mesh.ubT_);
         std::string fieldsName = "fieldsSave" + std::to_string(mesh.ubT_);
         //- write out input data for python to plot
@@ -288,7 +441,7 @@ int main(int argc,char * argv[])
         
       }
       //- stop training if target loss achieved
-      if (loss < mesh.net_->ABS_TOL) 
+      if (loss < mesh.net_->ABS_TOL && curriculum.complete()) 
       {
         std::string modelName = "pNet" + std::to_string(mesh.ubT_) + ".pt"; // ".pt" is the extension of for pyTorch module
         //- save model to file for post processing, indicate saved model is due to convergence
@@ -300,6 +453,7 @@ int main(int argc,char * argv[])
       }
       iter += 1;
     }
+    metrics.close();
     //- end profile clock
     auto end_time = std::chrono::high_resolution_clock::now();
     
@@ -308,6 +462,32 @@ int main(int argc,char * argv[])
 
     //- info out runTime
     std::cout << "Epoch execution time: " << duration.count() << " microseconds" << std::endl;
+    std::cout << "Epochs used: " << iter - 1 << "\n";
+    control.info();
+
+    //- train the window again with a thinner interface, weights are kept
+    if(continuation.next(mesh))
+    {
+      continue;
+    }
+
+    //- retry the window with a smaller step if training failed
+    if
+    (
+      !marching.accept
+      (
+        loss < mesh.net_->ABS_TOL,
+        iter - 1,
+        control.budget_,
+        lastTerms[CahnHillard::IC]
+      )
+    )
+    {
+      std::cout<<"Window rejected, retrying with step: "<<marching.step_<<"\n";
+      mesh.setWindow(mesh.lbT_,mesh.lbT_ + marching.step_);
+      mesh.net_->reset_layers();
+      continue;
+    }
     
     //- Grid  for plotting final timeStep
     torch::Tensor grid = torch::stack
@@ -322,6 +502,8 @@ int main(int argc,char * argv[])
     
     //- get predicted output, and from that get phaseField 
     torch::Tensor C1 = mesh.net_->forward(grid);
+    //- full domain of a symmetric case
+    mesh.mirror(grid,C1);
     
     //- file Names for the
     std::string gridName = "grid" + std::to_string(mesh.ubT_);
@@ -330,11 +512,27 @@ int main(int argc,char * argv[])
     //- write out input data for python to plot
     writeTensorToFile(grid,gridName);
     writeTensorToFile(C1,fieldsName); 
+    //- true convergence metric, residual over the complete lattice
+    if(netDict.lookupOrDefault<int>("residualEval",0))
+    {
+      residualEvaluator residual(mesh,netDict);
+      residual.evaluate();
+      residual.info();
+      residual.write("residual" + std::to_string(mesh.ubT_));
+    }
+    //- release step temporaries of this window
+    if(cachingCPUAllocator::instance())
+    {
+      std::cout<<"Peak tensor memory: "
+        <<(cachingCPUAllocator::instance()->peak() >> 20)<<" MB\n";
+      cachingCPUAllocator::instance()->emptyCache();
+      cachingCPUAllocator::instance()->resetPeak();
+    }
     //- update the mesh with new temporal bounds
-    mesh.updateMesh();
+    marching.advance(mesh);
     //- reset the neural network
     mesh.net_->reset_layers();
-    
+    N++;
   }
   return 0;
 } 
@@ -0,0 +1,133 @@
+#include "../include/allocator.h"
+#include <c10/core/impl/alloc_cpu.h>
+#include <algorithm>
+#include <cstring>
+//- sizes are rounded up to multiples of this to improve reuse
+static const size_t roundSize = 512;
+
+//- installed allocator instance
+static cachingCPUAllocator* installed = nullptr;
+
+cachingCPUAllocator::cachingCPUAllocator(size_t maxCached)
+:
+  maxCached_(maxCached),
+  allocated_(0),
+  peak_(0),
+  cached_(0)
+{}
+
+//- hand out cached block of the same rounded size if available
+c10::DataPtr cachingCPUAllocator::allocate(size_t nbytes)
+{
+  size_t size = ((nbytes + roundSize - 1)/roundSize)*roundSize;
+  block* b = new block{nullptr,size};
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = freeBlocks_.find(size);
+    if(it != freeBlocks_.end() && !it->second.empty())
+    {
+      b->ptr = it->second.back();
+      it->second.pop_back();
+      cached_ -= size;
+    }
+    allocated_ += size;
+    peak_ = std::max(peak_,allocated_);
+  }
+  if(!b->ptr && size > 0)
+  {
+    b->ptr = c10::alloc_cpu(size);
+  }
+  return {b->ptr,b,&cachingCPUAllocator::release,c10::Device(c10::DeviceType::CPU)};
+}
+
+void cachingCPUAllocator::copy_data
+(
+  void* dest,
+  const void* src,
+  std::size_t count
+) const
+{
+  std::memcpy(dest,src,count);
+}
+
+void cachingCPUAllocator::release(void* ctx)
+{
+  installed->free(static_cast<block*>(ctx));
+}
+
+//- keep block for reuse unless the cache is full
+void cachingCPUAllocator::free(block* b)
+{
+  bool keep = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    allocated_ -= b->size;
+    if(b->ptr && cached_ + b->size <= maxCached_)
+    {
+      freeBlocks_[b->size].push_back(b->ptr);
+      cached_ += b->size;
+      keep = true;
+    }
+  }
+  if(!keep && b->ptr)
+  {
+    c10::free_cpu(b->ptr);
+  }
+  delete b;
+}
+
+//- release all cached blocks, e.g at the end of a time window
+void cachingCPUAllocator::emptyCache()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  for(auto &sizeBlocks : freeBlocks_)
+  {
+    for(void* ptr : sizeBlocks.second)
+    {
+      c10::free_cpu(ptr);
+    }
+  }
+  freeBlocks_.clear();
+  cached_ = 0;
+}
+
+void cachingCPUAllocator::resetPeak()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  peak_ = allocated_;
+}
+
+size_t cachingCPUAllocator::allocated() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return allocated_;
+}
+
+size_t cachingCPUAllocator::peak() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return peak_;
+}
+
+size_t cachingCPUAllocator::cached() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return cached_;
+}
+
+//- register with c10, never destroyed since tensors may outlive main
+cachingCPUAllocator* cachingCPUAllocator::install(size_t maxCached)
+{
+  if(!installed)
+  {
+    installed = new cachingCPUAllocator(maxCached);
+    //- priority above the default CPU allocator
+    c10::SetAllocator(c10::DeviceType::CPU,installed,1);
+  }
+  return installed;
+}
+
+cachingCPUAllocator* cachingCPUAllocator::instance()
+{
+  return installed;
+}
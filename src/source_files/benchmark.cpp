@@ -0,0 +1,124 @@
+#include "../include/benchmark.h"
+#include "../include/pinn.h"
+#include "../include/mesh.h"
+#include "../include/ch.h"
+#include <ATen/CPUGeneratorImpl.h>
+#include <chrono>
+#include <iomanip>
+#include <utility>
+#include <vector>
+//- architecture variant, overrides of the [net] section
+struct architectureVariant
+{
+  std::string label;
+  std::vector<std::pair<std::string,std::string>> overrides;
+};
+
+//- variants timed by the benchmark
+static std::vector<architectureVariant> variants(const Dictionary &netDict)
+{
+  std::vector<architectureVariant> list;
+  for(const std::string activation : {"silu","tanh","gelu","sin"})
+  {
+    for(const std::string normalization : {"batchNorm","layerNorm","none"})
+    {
+      list.push_back
+      (
+        {
+          activation + "/" + normalization,
+          {{"activation",activation},{"normalization",normalization}}
+        }
+      );
+    }
+  }
+  //- init schemes of the hidden layers
+  for(const std::string init : {"xavierNormal","xavierUniform","kaimingNormal","default"})
+  {
+    list.push_back({"init/" + init,{{"init",init}}});
+  }
+  //- toggle residual connections and Fourier features of the case
+  int residual = netDict.lookupOrDefault<int>("residual",0);
+  list.push_back
+  (
+    {
+      residual ? "case/noResidual" : "case/residual",
+      {{"residual",std::to_string(1 - residual)}}
+    }
+  );
+  int fourier = netDict.lookupOrDefault<int>("fourierFeatures",0);
+  list.push_back
+  (
+    {
+      fourier ? "case/noFourier" : "case/fourier64",
+      {{"fourierFeatures",fourier ? "0" : "64"}}
+    }
+  );
+  return list;
+}
+
+void benchmarkArchitectures
+(
+  const caseConfig &config,
+  torch::Device &device,
+  thermoPhysical &thermo
+)
+{
+  const int nSteps = config.runtime_.benchmarkSteps;
+  //- variants are seeded, leave the global random stream as it was
+  at::Generator generator = at::detail::getDefaultCPUGenerator();
+  torch::Tensor rngState = generator.get_state();
+  std::cout<<"Benchmarking architectures, "<<nSteps<<" steps each...\n";
+  std::cout<<std::setw(24)<<"variant"<<std::setw(16)<<"ms/step"
+    <<std::setw(16)<<"final loss"<<"\n";
+  for(const architectureVariant &variant : variants(config.net))
+  {
+    //- nets keep a reference to the Dictionary, keep it alive in this scope
+    Dictionary netDict = config.net;
+    Dictionary meshDict = config.mesh;
+    for(const auto &entry : variant.overrides)
+    {
+      netDict.set(entry.first,entry.second);
+    }
+    //- same seed for every variant
+    torch::manual_seed(0);
+    auto net1 = PinNet(netDict);
+    auto net2 = PinNet(netDict);
+    net1->to(device);
+    net2->to(device);
+    mesh2D mesh(meshDict,net1,net2,device,thermo);
+    torch::optim::Adam optim
+    (
+      mesh.net_->parameters(), 
+      torch::optim::AdamOptions(config.optim_.lRate)
+    );
+    //- one optimizer step on a single batch
+    auto step = [&]()
+    {
+      mesh.update(0);
+      torch::Tensor loss = CahnHillard::loss(mesh);
+      loss.backward();
+      optim.step();
+      optim.zero_grad();
+      return loss.detach();
+    };
+    //- warm up, first step allocates the buffers
+    step();
+    torch::Tensor loss;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for(int i=0;i<nSteps;i++)
+    {
+      loss = step();
+    }
+    //- item() waits for the device to finish
+    float finalLoss = loss.item<float>();
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>
+    (
+      end_time - start_time
+    );
+    std::cout<<std::setw(24)<<variant.label
+      <<std::setw(16)<<std::setprecision(5)<<duration.count()/(1000.0*nSteps)
+      <<std::setw(16)<<std::setprecision(7)<<finalLoss<<"\n";
+  }
+  generator.set_state(rngState);
+}
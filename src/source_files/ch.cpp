@@ -3,6 +3,9 @@
 #include "../include/mesh.h"
 #include "../include/derivatives.h"
 #include "../include/thermo.h"
+#include <array>
+#include <map>
+#include <sstream>
 //- thermoPhysical properties for mixture
 torch::Tensor CahnHillard::thermoProp
 (
@@ -18,8 +21,58 @@ torch::Tensor CahnHillard::thermoProp
   return mixtureProp;
 }
 
-//- continuity loss 
-torch::Tensor CahnHillard::L_Mass2D
+//- mean square of a tensor, replaces mse_loss against a zeros_like target 
+//- and saves allocating the target and the difference
+torch::Tensor CahnHillard::meanSquare(const torch::Tensor &R)
+{
+  return torch::mean(torch::square(R));
+}
+
+//- mean square of a residual over iPDE_, causally weighted in time if enabled
+torch::Tensor CahnHillard::residualLoss
+(
+  const mesh2D &mesh,
+  const torch::Tensor &R
+)
+{
+  if(mesh.net_->causal_)
+  {
+    return CahnHillard::causalLoss(mesh,R);
+  }
+  return CahnHillard::meanSquare(R);
+}
+
+//- causality respecting loss, points in iPDE_ are binned by time and the 
+//- mean square residual of each bin is weighted by exp(-eps*sum of the mean
+//- square residuals of all earlier bins), later times only contribute once
+//- the earlier times are resolved
+torch::Tensor CahnHillard::causalLoss
+(
+  const mesh2D &mesh,
+  const torch::Tensor &R
+)
+{
+  const int nBins = mesh.net_->N_CAUSAL_BINS;
+  //- time bin of every collocation point
+  torch::Tensor t = mesh.iPDE_.index({Slice(),2}).detach();
+  torch::Tensor bin = torch::floor
+  (
+    (t - mesh.lbT_)/(mesh.ubT_ - mesh.lbT_)*nBins
+  ).clamp(0,nBins - 1).to(torch::kLong);
+  //- mean square residual of each bin
+  torch::Tensor binSum = torch::zeros({nBins},R.options()).index_add(0,bin,R*R);
+  torch::Tensor binCount = torch::bincount(bin,{},nBins).to(R.dtype()).clamp_min(1);
+  torch::Tensor binLoss = binSum/binCount;
+  //- weights from accumulated residual of the earlier bins, not trained on
+  torch::Tensor w = torch::exp
+  (
+    -mesh.net_->CAUSAL_EPS*(torch::cumsum(binLoss,0) - binLoss)
+  ).detach();
+  return torch::mean(w*binLoss);
+}
+
+//- continuity residual at every point in iPDE_
+torch::Tensor CahnHillard::R_Mass2D
 (
   const mesh2D &mesh 
 )
@@ -28,16 +81,29 @@ torch::Tensor CahnHillard::L_Mass2D
   const torch::Tensor &v = mesh.fieldsPDE_.index({Slice(),1});
   torch::Tensor du_dx = d_d1(u,mesh.iPDE_,0);
   torch::Tensor dv_dy = d_d1(v,mesh.iPDE_,1);
-  torch::Tensor loss = du_dx + dv_dy;
-  return torch::mse_loss(loss, torch::zeros_like(loss));
+  return du_dx + dv_dy;
 }
 
-//- returns the phi term needed 
+//- continuity loss 
+torch::Tensor CahnHillard::L_Mass2D
+(
+  const mesh2D &mesh 
+)
+{
+  return CahnHillard::residualLoss(mesh,CahnHillard::pdeResidual(mesh,MASS));
+}
+
+//- returns the phi term needed, in the mixed formulation phi is the 
+//- chemical potential output of the net and no derivatives are taken
 torch::Tensor CahnHillard::phi
 (
   const mesh2D &mesh
 )
 {
+  if(mesh.net_->mixed_)
+  {
+    return mesh.fieldsPDE_.index({Slice(),4});
+  }
   float &e = mesh.thermo_.epsilon;
   const torch::Tensor &C = mesh.fieldsPDE_.index({Slice(),3});
   torch::Tensor Cxx = d_dn(C,mesh.iPDE_,2,0);
@@ -45,8 +111,8 @@ torch::Tensor CahnHillard::phi
   return C*(C*C-1) - e*e*(Cxx + Cyy); 
 }
 
-//- returns CahnHillard Loss
-torch::Tensor CahnHillard::CahnHillard2D
+//- returns CahnHillard residual at every point in iPDE_
+torch::Tensor CahnHillard::R_CahnHillard2D
 (
   const mesh2D &mesh
 )
@@ -66,10 +132,45 @@ torch::Tensor CahnHillard::CahnHillard2D
   torch::Tensor phi = CahnHillard::phi(mesh);
   torch::Tensor dphi_dxx = d_dn(phi,mesh.iPDE_,2,0);
   torch::Tensor dphi_dyy = d_dn(phi,mesh.iPDE_,2,1);
-  //- loss term
-  torch::Tensor loss = dC_dt + u*dC_dx + v*dC_dy - 
-    Mo*(dphi_dxx + dphi_dyy);
-  return torch::mse_loss(loss,torch::zeros_like(loss));
+  //- residual
+  return dC_dt + u*dC_dx + v*dC_dy - Mo*(dphi_dxx + dphi_dyy);
+}
+
+//- consistency of the chemical potential output with C in the mixed 
+//- formulation, highest derivative order of all residuals is two
+torch::Tensor CahnHillard::R_ChemPot2D
+(
+  const mesh2D &mesh
+)
+{
+  float &e = mesh.thermo_.epsilon;
+  const torch::Tensor &C = mesh.fieldsPDE_.index({Slice(),3});
+  const torch::Tensor &mu = mesh.fieldsPDE_.index({Slice(),4});
+  torch::Tensor Cxx = d_dn(C,mesh.iPDE_,2,0);
+  torch::Tensor Cyy = d_dn(C,mesh.iPDE_,2,1);
+  return mu - (C*(C*C-1) - e*e*(Cxx + Cyy));
+}
+
+//- chemical potential loss, zero without the mixed formulation
+torch::Tensor CahnHillard::L_ChemPot2D
+(
+  const mesh2D &mesh
+)
+{
+  if(!mesh.net_->mixed_)
+  {
+    return torch::zeros({},mesh.fieldsPDE_.options());
+  }
+  return CahnHillard::residualLoss(mesh,CahnHillard::pdeResidual(mesh,MU));
+}
+
+//- returns CahnHillard Loss
+torch::Tensor CahnHillard::CahnHillard2D
+(
+  const mesh2D &mesh
+)
+{
+  return CahnHillard::residualLoss(mesh,CahnHillard::pdeResidual(mesh,CH));
 }
 
 //- returns the surface tension tensor needed in mom equation
@@ -87,8 +188,8 @@ torch::Tensor CahnHillard::surfaceTension
   return surf;
 } 
 
-//- momentum loss for x direction in 2D 
-torch::Tensor CahnHillard::L_MomX2d
+//- momentum residual for x direction in 2D 
+torch::Tensor CahnHillard::R_MomX2d
 (
   const mesh2D &mesh
 )
@@ -121,12 +222,20 @@ torch::Tensor CahnHillard::L_MomX2d
   torch::Tensor loss2 = -0.5*(muL - muG)*dC_dy*(du_dy + dv_dx) - (muL -muG)*dC_dx*du_dx;
   torch::Tensor loss3 = -muM*(du_dxx + du_dyy) - fx;
   //- division by rhoL for normalization, loss starts out very large otherwise
-  torch::Tensor loss = (loss1 + loss2 + loss3)/rhoL;
-  return torch::mse_loss(loss, torch::zeros_like(loss));
+  return (loss1 + loss2 + loss3)/rhoL;
 }
 
-//- momentum loss for y direction in 2D
-torch::Tensor CahnHillard::L_MomY2d
+//- momentum loss for x direction in 2D 
+torch::Tensor CahnHillard::L_MomX2d
+(
+  const mesh2D &mesh
+)
+{
+  return CahnHillard::residualLoss(mesh,CahnHillard::pdeResidual(mesh,MOMX));
+}
+
+//- momentum residual for y direction in 2D
+torch::Tensor CahnHillard::R_MomY2d
 (
   const mesh2D &mesh
 )
@@ -155,12 +264,199 @@ torch::Tensor CahnHillard::L_MomY2d
   torch::Tensor dv_dyy = d_dn(v,mesh.iPDE_,2,1);
   //- get x component of the surface tension force
   torch::Tensor fy = CahnHillard::surfaceTension(mesh,1);
-  torch::Tensor gy = torch::full_like(fy,-0.98);
+  //- gravity, scalar instead of a full tensor
+  const float gy = -0.98;
+  torch::Tensor loss1 = rhoM*(dv_dt + u*dv_dx + v*dv_dy) + dp_dy;
+  torch::Tensor loss2 = -0.5*(muL - muG)*dC_dx*(du_dx + dv_dy) - (muL -muG)*dC_dy*dv_dy;
+  torch::Tensor loss3 = -muM*(dv_dxx + dv_dyy) - fy - rhoM*gy;
+  return (loss1 + loss2 + loss3)/rhoL;
+}
+
+//- momentum loss for y direction in 2D
+torch::Tensor CahnHillard::L_MomY2d
+(
+  const mesh2D &mesh
+)
+{
+  return CahnHillard::residualLoss(mesh,CahnHillard::pdeResidual(mesh,MOMY));
+}
+
+//-------------------finite difference residuals-----------------------------//
+//  derivatives are central differences of the net output on the stencil
+//  around each PDE point (mesh.fieldsStencil_), only forward passes enter 
+//  the graph, the highest order needed is the biharmonic of C in the CH 
+//  equation which is the 5 point Laplacian of the 5 point Laplacian
+
+//- is the residual of a loss term evaluated with finite differences
+bool CahnHillard::fdTerm(const mesh2D &mesh, int term)
+{
+  std::stringstream ss(mesh.net_->FD_TERMS);
+  std::string name;
+  while(std::getline(ss,name,','))
+  {
+    if(name == CahnHillard::lossTermName(term))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//- output component of the net at one point of the stencil
+torch::Tensor CahnHillard::fdField(const mesh2D &mesh, int point, int comp)
+{
+  return mesh.fieldsStencil_.select(0,point).select(1,comp);
+}
+
+//- first derivative, central difference in dim
+torch::Tensor CahnHillard::fdD1(const mesh2D &mesh, int comp, int dim)
+{
+  const int plus[3] = {S_XP,S_YP,S_TP};
+  const int minus[3] = {S_XM,S_YM,S_TM};
+  const float h = (dim == 2) ? mesh.net_->FD_HT : mesh.net_->FD_H;
+  return 
+  (
+    CahnHillard::fdField(mesh,plus[dim],comp) 
+  - CahnHillard::fdField(mesh,minus[dim],comp)
+  )/(2*h);
+}
+
+//- second derivative in spatial direction dim at the centre
+torch::Tensor CahnHillard::fdD2(const mesh2D &mesh, int comp, int dim)
+{
+  const float h = mesh.net_->FD_H;
+  return 
+  (
+    CahnHillard::fdField(mesh,dim == 0 ? S_XP : S_YP,comp) 
+  - 2*CahnHillard::fdField(mesh,S_C,comp)
+  + CahnHillard::fdField(mesh,dim == 0 ? S_XM : S_YM,comp)
+  )/(h*h);
+}
+
+//- 5 point Laplacian at one of the points S_C, S_XP, S_XM, S_YP, S_YM
+torch::Tensor CahnHillard::fdLaplacian(const mesh2D &mesh, int comp, int point)
+{
+  //- neighbours (x+, x-, y+, y-) of the inner stencil points
+  static const std::map<int, std::array<int,4>> neighbours = 
+  {
+    {S_C, {S_XP,S_XM,S_YP,S_YM}},
+    {S_XP,{S_X2P,S_C,S_XPYP,S_XPYM}},
+    {S_XM,{S_C,S_X2M,S_XMYP,S_XMYM}},
+    {S_YP,{S_XPYP,S_XMYP,S_Y2P,S_C}},
+    {S_YM,{S_XPYM,S_XMYM,S_C,S_Y2M}}
+  };
+  const float h = mesh.net_->FD_H;
+  const std::array<int,4> &n = neighbours.at(point);
+  return 
+  (
+    CahnHillard::fdField(mesh,n[0],comp) + CahnHillard::fdField(mesh,n[1],comp)
+  + CahnHillard::fdField(mesh,n[2],comp) + CahnHillard::fdField(mesh,n[3],comp)
+  - 4*CahnHillard::fdField(mesh,point,comp)
+  )/(h*h);
+}
+
+//- phi at one of the inner stencil points
+torch::Tensor CahnHillard::fdPhi(const mesh2D &mesh, int point)
+{
+  if(mesh.net_->mixed_)
+  {
+    return CahnHillard::fdField(mesh,point,4);
+  }
+  const float &e = mesh.thermo_.epsilon;
+  torch::Tensor C = CahnHillard::fdField(mesh,point,3);
+  return C*(C*C-1) - e*e*CahnHillard::fdLaplacian(mesh,3,point);
+}
+
+//- continuity residual with finite differences
+torch::Tensor CahnHillard::R_Mass2D_FD(const mesh2D &mesh)
+{
+  return CahnHillard::fdD1(mesh,0,0) + CahnHillard::fdD1(mesh,1,1);
+}
+
+//- CahnHillard residual with finite differences
+torch::Tensor CahnHillard::R_CahnHillard2D_FD(const mesh2D &mesh)
+{
+  const float &Mo = mesh.thermo_.Mo;
+  torch::Tensor u = CahnHillard::fdField(mesh,S_C,0);
+  torch::Tensor v = CahnHillard::fdField(mesh,S_C,1);
+  //- Laplacian of phi from phi on the inner 5 points
+  const float h = mesh.net_->FD_H;
+  torch::Tensor lapPhi = 
+  (
+    CahnHillard::fdPhi(mesh,S_XP) + CahnHillard::fdPhi(mesh,S_XM)
+  + CahnHillard::fdPhi(mesh,S_YP) + CahnHillard::fdPhi(mesh,S_YM)
+  - 4*CahnHillard::fdPhi(mesh,S_C)
+  )/(h*h);
+  return CahnHillard::fdD1(mesh,3,2) + u*CahnHillard::fdD1(mesh,3,0)
+    + v*CahnHillard::fdD1(mesh,3,1) - Mo*lapPhi;
+}
+
+//- chemical potential consistency with finite differences
+torch::Tensor CahnHillard::R_ChemPot2D_FD(const mesh2D &mesh)
+{
+  const float &e = mesh.thermo_.epsilon;
+  torch::Tensor C = CahnHillard::fdField(mesh,S_C,3);
+  torch::Tensor mu = CahnHillard::fdField(mesh,S_C,4);
+  return mu - (C*(C*C-1) - e*e*CahnHillard::fdLaplacian(mesh,3,S_C));
+}
+
+//- momentum residual for x direction with finite differences
+torch::Tensor CahnHillard::R_MomX2d_FD(const mesh2D &mesh)
+{
+  float &rhoL = mesh.thermo_.rhoL;
+  float &muL = mesh.thermo_.muL;
+  float rhoG = mesh.thermo_.rhoG;
+  float muG = mesh.thermo_.muG;
+  const torch::Tensor fields = mesh.fieldsStencil_.select(0,S_C);
+  torch::Tensor u = fields.index({Slice(),0});
+  torch::Tensor v = fields.index({Slice(),1});
+  torch::Tensor rhoM = CahnHillard::thermoProp(rhoL, rhoG, fields);
+  torch::Tensor muM = CahnHillard::thermoProp(muL, muG, fields);
+  torch::Tensor du_dt = CahnHillard::fdD1(mesh,0,2);
+  torch::Tensor du_dx = CahnHillard::fdD1(mesh,0,0);
+  torch::Tensor du_dy = CahnHillard::fdD1(mesh,0,1);
+  torch::Tensor dv_dx = CahnHillard::fdD1(mesh,1,0);
+  torch::Tensor dC_dx = CahnHillard::fdD1(mesh,3,0);
+  torch::Tensor dC_dy = CahnHillard::fdD1(mesh,3,1);
+  torch::Tensor dp_dx = CahnHillard::fdD1(mesh,2,0);
+  torch::Tensor du_dxx = CahnHillard::fdD2(mesh,0,0);
+  torch::Tensor du_dyy = CahnHillard::fdD2(mesh,0,1);
+  torch::Tensor fx = mesh.thermo_.sigma0/mesh.thermo_.epsilon*mesh.thermo_.C
+    *CahnHillard::fdPhi(mesh,S_C)*dC_dx;
+  torch::Tensor loss1 = rhoM*(du_dt + u*du_dx + v*du_dy) + dp_dx;
+  torch::Tensor loss2 = -0.5*(muL - muG)*dC_dy*(du_dy + dv_dx) - (muL -muG)*dC_dx*du_dx;
+  torch::Tensor loss3 = -muM*(du_dxx + du_dyy) - fx;
+  return (loss1 + loss2 + loss3)/rhoL;
+}
+
+//- momentum residual for y direction with finite differences
+torch::Tensor CahnHillard::R_MomY2d_FD(const mesh2D &mesh)
+{
+  float &rhoL = mesh.thermo_.rhoL;
+  float &muL = mesh.thermo_.muL;
+  float rhoG = mesh.thermo_.rhoG;
+  float muG = mesh.thermo_.muG;
+  const torch::Tensor fields = mesh.fieldsStencil_.select(0,S_C);
+  torch::Tensor u = fields.index({Slice(),0});
+  torch::Tensor v = fields.index({Slice(),1});
+  torch::Tensor rhoM = CahnHillard::thermoProp(rhoL, rhoG, fields);
+  torch::Tensor muM = CahnHillard::thermoProp(muL, muG, fields);
+  torch::Tensor dv_dt = CahnHillard::fdD1(mesh,1,2);
+  torch::Tensor dv_dx = CahnHillard::fdD1(mesh,1,0);
+  torch::Tensor dv_dy = CahnHillard::fdD1(mesh,1,1);
+  torch::Tensor du_dx = CahnHillard::fdD1(mesh,0,0);
+  torch::Tensor dC_dx = CahnHillard::fdD1(mesh,3,0);
+  torch::Tensor dC_dy = CahnHillard::fdD1(mesh,3,1);
+  torch::Tensor dp_dy = CahnHillard::fdD1(mesh,2,1);
+  torch::Tensor dv_dxx = CahnHillard::fdD2(mesh,1,0);
+  torch::Tensor dv_dyy = CahnHillard::fdD2(mesh,1,1);
+  torch::Tensor fy = mesh.thermo_.sigma0/mesh.thermo_.epsilon*mesh.thermo_.C
+    *CahnHillard::fdPhi(mesh,S_C)*dC_dy;
+  const float gy = -0.98;
   torch::Tensor loss1 = rhoM*(dv_dt + u*dv_dx + v*dv_dy) + dp_dy;
   torch::Tensor loss2 = -0.5*(muL - muG)*dC_dx*(du_dx + dv_dy) - (muL -muG)*dC_dy*dv_dy;
   torch::Tensor loss3 = -muM*(dv_dxx + dv_dyy) - fy - rhoM*gy;
-  torch::Tensor loss = (loss1 + loss2 + loss3)/rhoL;
-  return torch::mse_loss(loss, torch::zeros_like(loss));
+  return (loss1 + loss2 + loss3)/rhoL;
 }
 
 //- get total PDE loss
@@ -171,8 +467,9 @@ torch::Tensor CahnHillard::PDEloss(mesh2D &mesh)
   torch::Tensor LMX = CahnHillard::L_MomX2d(mesh);
   torch::Tensor LMY = CahnHillard::L_MomY2d(mesh);
   torch::Tensor LC = CahnHillard::CahnHillard2D(mesh);
+  torch::Tensor LMU = CahnHillard::L_ChemPot2D(mesh);
   //- return total pde loss
-  return LM + LC + LMX + LMY;
+  return LM + LC + LMX + LMY + LMU;
 }
 
 //- TODO make the function more general by adding in another int for u or v
@@ -181,38 +478,133 @@ torch::Tensor CahnHillard::slipWall(torch::Tensor &I, torch::Tensor &X,int dim)
   const torch::Tensor &u = I.index({Slice(),0});  
   const torch::Tensor &v = I.index({Slice(),1});
   torch::Tensor dv_dx = d_d1(v,X,dim);
-  return torch::mse_loss(dv_dx,torch::zeros_like(dv_dx))
-    + torch::mse_loss(u,torch::zeros_like(u));
+  return CahnHillard::meanSquare(dv_dx) + CahnHillard::meanSquare(u);
 }
 
 torch::Tensor CahnHillard::noSlipWall(torch::Tensor &I, torch::Tensor &X)
 {
   const torch::Tensor &u = I.index({Slice(),0});
   const torch::Tensor &v = I.index({Slice(),1});
-  return torch::mse_loss(u,torch::zeros_like(u))  + 
-    torch::mse_loss(v,torch::zeros_like(v));
+  return CahnHillard::meanSquare(u) + CahnHillard::meanSquare(v);
   
 }
-//- get boundary loss
+//- point-wise boundary residuals, only the sides of the mesh that are 
+//- walls (or the symmetry plane) contribute, with hard constraints u = 0 on
+//- all walls and v = 0 on top and bottom hold by construction and drop out
+std::vector<torch::Tensor> CahnHillard::bcResiduals(mesh2D &mesh)
+{
+  const bool soft = !mesh.net_->hardBC_;
+  std::vector<torch::Tensor> R;
+  //- symmetry plane, u = 0 and zero normal gradient of v, p and C
+  if(mesh.leftIsSymmetry_)
+  {
+    const torch::Tensor &I = mesh.fieldsLeft_;
+    for(int comp : {1,2,3})
+    {
+      R.push_back(d_d1(I.index({Slice(),comp}),mesh.iLeftWall_,0));
+    }
+    if(soft)
+    {
+      R.push_back(I.index({Slice(),0}));
+    }
+  }
+  //- slip walls, u = 0 and dv/dx = 0
+  if(mesh.leftIsWall_)
+  {
+    R.push_back(d_d1(mesh.fieldsLeft_.index({Slice(),1}),mesh.iLeftWall_,0));
+    if(soft)
+    {
+      R.push_back(mesh.fieldsLeft_.index({Slice(),0}));
+    }
+    //+ CahnHillard::zeroGrad(Cleft, mesh.iLeftWall_, 0);
+  }
+  if(mesh.rightIsWall_)
+  {
+    R.push_back(d_d1(mesh.fieldsRight_.index({Slice(),1}),mesh.iRightWall_,0));
+    if(soft)
+    {
+      R.push_back(mesh.fieldsRight_.index({Slice(),0}));
+    }
+    //+ CahnHillard::zeroGrad(Cright, mesh.iRightWall_, 0);
+  }
+  //- no-slip walls, u = v = 0
+  if(mesh.topIsWall_ && soft)
+  {
+    R.push_back(mesh.fieldsTop_.index({Slice(),0}));
+    R.push_back(mesh.fieldsTop_.index({Slice(),1}));
+    //+ CahnHillard::zeroGrad(Ctop, mesh.iTopWall_, 1);
+  }
+  if(mesh.bottomIsWall_ && soft)
+  {
+    R.push_back(mesh.fieldsBottom_.index({Slice(),0}));
+    R.push_back(mesh.fieldsBottom_.index({Slice(),1}));
+    //+ CahnHillard::zeroGrad(Cbottom, mesh.iBottomWall_, 1);
+  }
+  return R;
+}
+
+//- get boundary loss, sum of the mean squares of the boundary residuals
 torch::Tensor CahnHillard::BCloss(mesh2D &mesh)
 {
-  
-  //- get phase field vars at all the boundaries
-  torch::Tensor Cleft = mesh.fieldsLeft_.index({Slice(),3});
-  torch::Tensor Cright = mesh.fieldsRight_.index({Slice(),3});
-  torch::Tensor Ctop = mesh.fieldsTop_.index({Slice(),3});
-  torch::Tensor Cbottom = mesh.fieldsBottom_.index({Slice(),3});
-  
   //- total boundary loss for u, v and C
-  torch::Tensor lossLeft = CahnHillard::slipWall(mesh.fieldsLeft_, mesh.iLeftWall_,0); 
-       //+ CahnHillard::zeroGrad(Cleft, mesh.iLeftWall_, 0);
-  torch::Tensor lossRight = CahnHillard::slipWall(mesh.fieldsRight_,mesh.iRightWall_, 0);
-       //+ CahnHillard::zeroGrad(Cright, mesh.iRightWall_, 0);
-  torch::Tensor lossTop = CahnHillard::noSlipWall(mesh.fieldsTop_, mesh.iTopWall_);
-       //+ CahnHillard::zeroGrad(Ctop, mesh.iTopWall_, 1);
-  torch::Tensor lossBottom = CahnHillard::noSlipWall(mesh.fieldsBottom_, mesh.iBottomWall_);
-       //+ CahnHillard::zeroGrad(Cbottom, mesh.iBottomWall_, 1);
-  return lossLeft + lossRight + lossTop + lossBottom;
+  torch::Tensor loss = torch::zeros({},mesh.fieldsPDE_.options());
+  for(const torch::Tensor &R : CahnHillard::bcResiduals(mesh))
+  {
+    loss = loss + CahnHillard::meanSquare(R);
+  }
+  return loss;
+}
+
+//- residual of a PDE loss term, finite differences or autograd
+torch::Tensor CahnHillard::pdeResidual(const mesh2D &mesh, int term)
+{
+  const bool fd = CahnHillard::fdTerm(mesh,term);
+  switch(term)
+  {
+    case MASS:
+      return fd ? CahnHillard::R_Mass2D_FD(mesh) : CahnHillard::R_Mass2D(mesh);
+    case MOMX:
+      return fd ? CahnHillard::R_MomX2d_FD(mesh) : CahnHillard::R_MomX2d(mesh);
+    case MOMY:
+      return fd ? CahnHillard::R_MomY2d_FD(mesh) : CahnHillard::R_MomY2d(mesh);
+    case CH:
+      return fd ? 
+        CahnHillard::R_CahnHillard2D_FD(mesh) : CahnHillard::R_CahnHillard2D(mesh);
+    default:
+      return fd ? CahnHillard::R_ChemPot2D_FD(mesh) : CahnHillard::R_ChemPot2D(mesh);
+  }
+}
+
+//- all point-wise residuals of the loss as one vector, every residual is 
+//- scaled by 1/sqrt(number of points) so that the sum of squares is the 
+//- (unweighted, not causally weighted) total loss
+torch::Tensor CahnHillard::residualVector(mesh2D &mesh)
+{
+  std::vector<torch::Tensor> R;
+  for(int term : {MASS,MOMX,MOMY,CH})
+  {
+    R.push_back(CahnHillard::pdeResidual(mesh,term));
+  }
+  if(mesh.net_->mixed_)
+  {
+    R.push_back(CahnHillard::pdeResidual(mesh,MU));
+  }
+  for(const torch::Tensor &bc : CahnHillard::bcResiduals(mesh))
+  {
+    R.push_back(bc);
+  }
+  if(mesh.net_->transient_ == 1)
+  {
+    for(int comp : {0,1,3})
+    {
+      R.push_back(mesh.fieldsIC_.index({Slice(),comp}) - mesh.icTarget_.index({Slice(),comp}));
+    }
+  }
+  for(torch::Tensor &r : R)
+  {
+    r = r.flatten()/std::sqrt(static_cast<float>(r.numel()));
+  }
+  return torch::cat(R);
 }
 
 //- get the intial loss for the 
@@ -232,72 +624,85 @@ torch::Tensor CahnHillard::ICloss(mesh2D &mesh)
   return uLoss +vLoss +CLoss;
 }
 
-//- total loss function for the optimizer
-torch::Tensor CahnHillard::loss(mesh2D &mesh)
+//- name of the loss term for info out
+std::string CahnHillard::lossTermName(int term)
 {
-  // torch::Tensor pdeloss = CahnHillard::PDEloss(mesh);
-  torch::Tensor bcLoss = CahnHillard::BCloss(mesh);
-  torch::Tensor pdeLoss = CahnHillard::PDEloss(mesh);
-  torch::Tensor icLoss = CahnHillard::ICloss(mesh);
-  return bcLoss + pdeLoss + icLoss;
+  const char* names[NTERMS] = {"Mass","MomX","MomY","CH","MU","BC","IC"};
+  return names[term];
 }
 
-
-//- TODO make radius a variable 
-torch::Tensor CahnHillard::C_at_InitialTime(mesh2D &mesh)
+//- individual loss terms, PDE loss is split into its equations, returns
+//- the plain mean squares, trainTerms gets the terms to back propagate,
+//- causally weighted PDE terms if enabled, both share the residuals
+std::vector<torch::Tensor> CahnHillard::lossTerms
+(
+  mesh2D &mesh,
+  std::vector<torch::Tensor> &trainTerms
+)
 {
-  if(mesh.lbT_ == 0)
+  std::vector<torch::Tensor> terms(NTERMS);
+  trainTerms.resize(NTERMS);
+  for(int term : {MASS,MOMX,MOMY,CH,MU})
   {
-    const float &xc = mesh.xc;
-    const float &yc = mesh.yc;
-    const float &e = mesh.thermo_.epsilon;
-    //- x 
-    const torch::Tensor &x = mesh.iIC_.index({Slice(),0});
-    //- y
-    const torch::Tensor &y = mesh.iIC_.index({Slice(),1});
-    //- intial condition
-    torch::Tensor Ci =torch::tanh((torch::sqrt(torch::pow(x - xc, 2) + torch::pow(y - yc, 2)) - 0.15)/ (1.41421356237 * e));
-    
-    return Ci;
+    if(term == MU && !mesh.net_->mixed_)
+    {
+      terms[MU] = CahnHillard::L_ChemPot2D(mesh);
+      trainTerms[MU] = terms[MU];
+      continue;
+    }
+    torch::Tensor R = CahnHillard::pdeResidual(mesh,term);
+    terms[term] = CahnHillard::meanSquare(R);
+    trainTerms[term] = 
+      mesh.net_->causal_ ? CahnHillard::causalLoss(mesh,R) : terms[term];
   }
-  else  
+  terms[BC] = CahnHillard::BCloss(mesh);
+  terms[IC] = CahnHillard::ICloss(mesh);
+  trainTerms[BC] = terms[BC];
+  trainTerms[IC] = terms[IC];
+  return terms;
+}
+
+//- plain mean square loss terms for monitoring
+std::vector<torch::Tensor> CahnHillard::lossTerms(mesh2D &mesh)
+{
+  std::vector<torch::Tensor> trainTerms;
+  return CahnHillard::lossTerms(mesh,trainTerms);
+}
+
+//- total loss from the individual terms
+torch::Tensor CahnHillard::loss(const std::vector<torch::Tensor> &terms)
+{
+  torch::Tensor total = terms[0];
+  for(int i=1;i<terms.size();i++)
   {
-    //- disable gradient tracking for netPrev predictions so optim steps don't update netPrev parameters 
-    //  every epoch
-    torch::NoGradGuard no_grad;
-    //- use previous converged neural net as intial conditions
-    torch::Tensor Ci = mesh.netPrev_->forward(mesh.iIC_).index({Slice(),3});
-    return Ci;
+    total = total + terms[i];
   }
+  return total;
+}
+
+//- total loss function for the optimizer, causally weighted if enabled
+torch::Tensor CahnHillard::loss(mesh2D &mesh)
+{
+  std::vector<torch::Tensor> trainTerms;
+  CahnHillard::lossTerms(mesh,trainTerms);
+  return CahnHillard::loss(trainTerms);
+}
+
+
+//- phase field at intial time, gathered from the initial condition table
+torch::Tensor CahnHillard::C_at_InitialTime(mesh2D &mesh)
+{
+  return mesh.icTarget_.index({Slice(),3});
 }
 //- intial velocity fields for u and v
 torch::Tensor CahnHillard::u_at_InitialTime(mesh2D &mesh)
 {
-  if(mesh.lbT_ ==0)
-  {
-    return torch::zeros_like(mesh.iIC_.index({Slice(),0}));
-    
-  }
-  else
-  {
-    //- disable grad tracking to stop optim.step() from updating netPrev_ parameters
-    torch::NoGradGuard no_grad;
-    return mesh.netPrev_->forward(mesh.iIC_).index({Slice(),0});
-  }
+  return mesh.icTarget_.index({Slice(),0});
 }
 //-v at intial time
 torch::Tensor CahnHillard::v_at_InitialTime(mesh2D &mesh)
 {
-  if(mesh.lbT_ ==0)
-  {
-    return torch::zeros_like(mesh.iIC_.index({Slice(),0}));
-  }
-  else
-  {
-    //- disable grad tracking to stop optim from updating netPrev parameters
-    torch::NoGradGuard no_grad;
-    return mesh.netPrev_->forward(mesh.iIC_).index({Slice(),1});
-  }
+  return mesh.icTarget_.index({Slice(),1});
 }
 
 
@@ -319,7 +724,7 @@ torch::Tensor CahnHillard::Cbar(const torch::Tensor &C)
 torch::Tensor CahnHillard::zeroGrad(torch::Tensor &I, torch::Tensor &X, int dim)
 { 
   torch::Tensor grad = d_d1(I,X,dim);
-  return torch::mse_loss(grad, torch::zeros_like(grad));
+  return CahnHillard::meanSquare(grad);
 }
 
 
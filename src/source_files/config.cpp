@@ -0,0 +1,489 @@
+#include "../include/config.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <limits>
+//- unbounded numeric values
+static const double inf = std::numeric_limits<double>::max();
+
+//------------------------------section schemas------------------------------//
+
+static const std::vector<configKey> runtimeSchema =
+{
+  {"DEBUG",          'i', false, "0",     0, 1, {}},
+  {"infoInterval",   'i', false, "10",    1, inf, {}},
+  {"saveInterval",   'i', false, "5000",  1, inf, {}},
+  {"benchmark",      'i', false, "0",     0, 1, {}},
+  {"benchmarkSteps", 'i', false, "20",    1, inf, {}},
+  {"metrics",        'i', false, "1",     0, 1, {}},
+  {"metricsFlush",   'i', false, "100",   1, inf, {}},
+  {"metricsFile",    's', false, "metrics", 0, 0, {}},
+  {"autoTune",       'i', false, "0",     0, 1, {}},
+  {"autoTuneSteps",  'i', false, "5",     1, inf, {}},
+  {"memoryBudgetMB", 'i', false, "0",     0, inf, {}},
+  {"autoTuneFile",   's', false, "tuning.txt", 0, 0, {}}
+};
+
+static const std::vector<configKey> meshSchema =
+{
+  {"lbX",            'f', true,  "",      -inf, inf, {}},
+  {"ubX",            'f', true,  "",      -inf, inf, {}},
+  {"lbY",            'f', true,  "",      -inf, inf, {}},
+  {"ubY",            'f', true,  "",      -inf, inf, {}},
+  {"lbT",            'f', true,  "",      0, inf, {}},
+  {"ubT",            'f', true,  "",      0, inf, {}},
+  {"dx",             'f', true,  "",      1e-12, inf, {}},
+  {"dy",             'f', true,  "",      1e-12, inf, {}},
+  {"dt",             'f', true,  "",      1e-12, inf, {}},
+  {"stepSize",       'f', true,  "",      1e-12, inf, {}},
+  {"xc",             'f', true,  "",      -inf, inf, {}},
+  {"yc",             'f', true,  "",      -inf, inf, {}},
+  {"endTime",        'f', false, "",      0, inf, {}},
+  {"adaptiveStep",   'i', false, "0",     0, 1, {}},
+  {"minStep",        'f', false, "",      1e-12, inf, {}},
+  {"maxStep",        'f', false, "",      1e-12, inf, {}},
+  {"growFactor",     'f', false, "1.5",   1, inf, {}},
+  {"shrinkFactor",   'f', false, "0.5",   1e-12, 1, {}},
+  {"fastFraction",   'f', false, "0.5",   0, 1, {}},
+  {"icTol",          'f', false, "1e-2",  0, inf, {}},
+  {"icType",         's', false, "analytic", 0, 0, {"analytic","file"}},
+  {"icFile",         's', false, "initialField.txt", 0, 0, {}},
+  {"radius",         'f', false, "0.15",  0, inf, {}},
+  {"symmetry",       'i', false, "0",     0, 1, {}},
+  {"interfaceFraction",'f', false, "0",   0, 1, {}},
+  {"interfaceDelta", 'f', false, "0.1",   0, 1, {}},
+  {"nSubX",          'i', false, "1",     1, inf, {}},
+  {"nSubY",          'i', false, "1",     1, inf, {}},
+  {"nInterface",     'i', false, "100",   1, inf, {}},
+  {"interfaceWeight",'f', false, "1",     0, inf, {}}
+};
+
+static const std::vector<configKey> netSchema =
+{
+  {"inputDim",       'i', true,  "",      1, inf, {}},
+  {"hiddenLayerDim", 'i', true,  "",      1, inf, {}},
+  {"nHiddenLayer",   'i', true,  "",      0, inf, {}},
+  {"outputDim",      'i', true,  "",      4, inf, {}},
+  {"NEQN",           'i', true,  "",      1, inf, {}},
+  {"NBC",            'i', true,  "",      1, inf, {}},
+  {"NIC",            'i', true,  "",      1, inf, {}},
+  {"transient",      'i', true,  "",      0, 1, {}},
+  {"KEPOCH",         'i', true,  "",      1, inf, {}},
+  {"ABSTOL",         'f', true,  "",      0, inf, {}},
+  {"optimizer",      's', false, "adam",  0, 0, {"adam","lm"}},
+  {"lmLambda",       'f', false, "1e-3",  0, inf, {}},
+  {"lmUp",           'f', false, "10",    1, inf, {}},
+  {"lmDown",         'f', false, "0.1",   0, 1, {}},
+  {"lmTries",        'i', false, "5",     1, inf, {}},
+  {"curriculum",     'i', false, "0",     0, 1, {}},
+  {"curriculumStart",'f', false, "0.25",  0, 1, {}},
+  {"curriculumGrow", 'f', false, "2",     1, inf, {}},
+  {"curriculumEpochs",'i', false, "10",   1, inf, {}},
+  {"curriculumStall",'f', false, "1e-2",  0, 1, {}},
+  {"curriculumPatience",'i', false, "5",  1, inf, {}},
+  {"BATCHSIZE",      'i', true,  "",      1, inf, {}},
+  {"residualEval",   'i', false, "0",     0, 1, {}},
+  {"residualTile",   'i', false, "1000",  1, inf, {}},
+  {"convControl",    'i', false, "0",     0, 1, {}},
+  {"convAlpha",      'f', false, "0.1",   0, 1, {}},
+  {"convWindow",     'i', false, "100",   1, inf, {}},
+  {"convMinEpoch",   'i', false, "100",   0, inf, {}},
+  {"convStallRate",  'f', false, "1e-3",  -inf, inf, {}},
+  {"convExtendRate", 'f', false, "5e-2",  -inf, inf, {}},
+  {"KEPOCHMAX",      'i', false, "",      1, inf, {}},
+  {"lossWeighting",  's', false, "none",  0, 0, {"none","annealing","gradNorm"}},
+  {"weightUpdate",   'i', false, "10",    1, inf, {}},
+  {"weightAlpha",    'f', false, "0.1",   0, 1, {}},
+  {"weightRef",      's', false, "CH",    0, 0, {"Mass","MomX","MomY","CH","MU","BC","IC"}},
+  {"wMass",          'f', false, "1",     0, inf, {}},
+  {"wMomX",          'f', false, "1",     0, inf, {}},
+  {"wMomY",          'f', false, "1",     0, inf, {}},
+  {"wCH",            'f', false, "1",     0, inf, {}},
+  {"wMU",            'f', false, "1",     0, inf, {}},
+  {"wBC",            'f', false, "1",     0, inf, {}},
+  {"wIC",            'f', false, "1",     0, inf, {}},
+  {"adaptMass",      'i', false, "1",     0, 1, {}},
+  {"adaptMomX",      'i', false, "1",     0, 1, {}},
+  {"adaptMomY",      'i', false, "1",     0, 1, {}},
+  {"adaptCH",        'i', false, "1",     0, 1, {}},
+  {"adaptMU",        'i', false, "1",     0, 1, {}},
+  {"adaptBC",        'i', false, "1",     0, 1, {}},
+  {"adaptIC",        'i', false, "1",     0, 1, {}},
+  {"causal",         'i', false, "0",     0, 1, {}},
+  {"causalBins",     'i', false, "10",    1, inf, {}},
+  {"causalEps",      'f', false, "1",     0, inf, {}},
+  {"normalizeInput", 'i', false, "0",     0, 1, {}},
+  {"fdTerms",        's', false, "none",  0, 0, {}},
+  {"fdH",            'f', false, "1e-2",  1e-12, inf, {}},
+  {"fdHt",           'f', false, "1e-2",  1e-12, inf, {}},
+  {"mixed",          'i', false, "0",     0, 1, {}},
+  {"hardBC",         'i', false, "0",     0, 1, {}},
+  {"activation",     's', false, "silu",  0, 0, {"silu","tanh","gelu","sin"}},
+  {"normalization",  's', false, "batchNorm", 0, 0, {"batchNorm","layerNorm","none"}},
+  {"residual",       'i', false, "0",     0, 1, {}},
+  {"fourierFeatures",'i', false, "0",     0, inf, {}},
+  {"fourierScale",   'f', false, "1",     0, inf, {}},
+  {"init",           's', false, "xavierNormal", 0, 0, 
+    {"xavierNormal","xavierUniform","kaimingNormal","default"}},
+  {"graphReuse",     'i', false, "0",     0, 1, {}},
+  {"flatParams",     'i', false, "0",     0, 1, {}},
+  {"arenaAllocator", 'i', false, "0",     0, 1, {}},
+  {"arenaMaxMB",     'i', false, "1024",  0, inf, {}}
+};
+
+static const std::vector<configKey> thermoSchema =
+{
+  {"Mo",             'f', true,  "",      0, inf, {}},
+  {"epsilon",        'f', true,  "",      1e-12, inf, {}},
+  {"epsilonStart",   'f', false, "0",     0, inf, {}},
+  {"epsilonFactor",  'f', false, "0.5",   1e-3, 0.999, {}},
+  {"sigma0",         'f', true,  "",      0, inf, {}},
+  {"rhoL",           'f', true,  "",      1e-12, inf, {}},
+  {"muL",            'f', true,  "",      0, inf, {}},
+  {"rhoG",           'f', true,  "",      1e-12, inf, {}},
+  {"muG",            'f', true,  "",      0, inf, {}}
+};
+
+static const std::vector<configKey> optimSchema =
+{
+  {"lRate",          'f', false, "1e-3",  1e-12, inf, {}},
+  {"lRateDecay",     'f', false, "0.1",   1e-12, 1, {}},
+  {"lRateEpochs",    'i', false, "4000",  1, inf, {}}
+};
+
+//- section names in the order they are printed
+static const std::vector<std::string> sectionNames = 
+{
+  "runtime","mesh","net","thermo","optim"
+};
+
+static const std::vector<configKey> &schemaOf(const std::string &name)
+{
+  if(name == "runtime") return runtimeSchema;
+  if(name == "mesh") return meshSchema;
+  if(name == "net") return netSchema;
+  if(name == "thermo") return thermoSchema;
+  return optimSchema;
+}
+
+//- strict parse, the complete value has to be consumed
+static bool parseNumber(const std::string &value, char type, double &result)
+{
+  std::istringstream iss(value);
+  if(type == 'i')
+  {
+    long n;
+    if(!(iss >> n)) return false;
+    result = n;
+  }
+  else
+  {
+    if(!(iss >> result)) return false;
+  }
+  std::string rest;
+  return !(iss >> rest);
+}
+
+//-----------------------------caseConfig definitions------------------------//
+
+//- read case file, apply command line overrides and validate
+caseConfig::caseConfig(int argc, char* argv[])
+:
+  fileName_("../case.txt")
+{
+  //- collect command line arguments
+  std::vector<std::string> assignments;
+  for(int i=1;i<argc;i++)
+  {
+    std::string arg = argv[i];
+    if(arg == "--case" && i + 1 < argc)
+    {
+      fileName_ = argv[++i];
+    }
+    else if(arg == "--set" && i + 1 < argc)
+    {
+      assignments.push_back(argv[++i]);
+    }
+    else
+    {
+      assignments.push_back(arg);
+    }
+  }
+  std::vector<std::string> errors;
+  //- read sections from file
+  std::ifstream file(fileName_);
+  if(!file.is_open())
+  {
+    std::cerr << "Unable to open file: " << fileName_ << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+  Dictionary* current = nullptr;
+  std::string line;
+  int lineNo = 0;
+  while(std::getline(file,line))
+  {
+    lineNo++;
+    //- strip comments
+    line = line.substr(0,std::min(line.find("//"),line.find('#')));
+    std::istringstream iss(line);
+    std::string key, value;
+    if(!(iss >> key))
+    {
+      continue;
+    }
+    if(key.front() == '[' && key.back() == ']')
+    {
+      current = section(key.substr(1,key.size() - 2));
+      if(!current)
+      {
+        errors.push_back(fileName_ + ":" + std::to_string(lineNo) + ": unknown section " + key);
+      }
+      continue;
+    }
+    if(!current)
+    {
+      errors.push_back(fileName_ + ":" + std::to_string(lineNo) + ": key " + key + " outside of a section");
+      continue;
+    }
+    if(!(iss >> value))
+    {
+      errors.push_back(fileName_ + ":" + std::to_string(lineNo) + ": no value for " + key);
+      continue;
+    }
+    current->set(key,value);
+  }
+  //- command line overrides section.key=value
+  for(const std::string &assignment : assignments)
+  {
+    size_t dot = assignment.find('.');
+    size_t eq = assignment.find('=');
+    Dictionary* dict = nullptr;
+    if(dot != std::string::npos && eq != std::string::npos && dot < eq)
+    {
+      dict = section(assignment.substr(0,dot));
+    }
+    if(!dict)
+    {
+      errors.push_back("invalid override " + assignment + ", expected section.key=value");
+      continue;
+    }
+    dict->set(assignment.substr(dot + 1,eq - dot - 1),assignment.substr(eq + 1));
+    overrides_.push_back(assignment.substr(0,eq));
+  }
+  //- validate all sections against their schemas
+  for(const std::string &name : sectionNames)
+  {
+    validate(name,*section(name),schemaOf(name),errors);
+  }
+  //- checks across keys
+  if(net.get<int>("mixed") && net.get<int>("outputDim") < 5)
+  {
+    errors.push_back("net: mixed formulation needs outputDim 5 (u v p C mu)");
+  }
+  //- sub-domains march with fixed windows only
+  bool decomposed = mesh.get<int>("nSubX")*mesh.get<int>("nSubY") > 1;
+  if(decomposed && mesh.get<int>("adaptiveStep"))
+  {
+    errors.push_back("mesh: adaptiveStep is not supported with nSubX/nSubY > 1");
+  }
+  //- peak memory of the tuner trials is measured by the arena allocator
+  if
+  (
+    runtime.get<int>("autoTune") && runtime.get<int>("memoryBudgetMB") > 0 &&
+    !net.get<int>("arenaAllocator")
+  )
+  {
+    errors.push_back("runtime: memoryBudgetMB needs net.arenaAllocator 1");
+  }
+  //- causal weighting bins the PDE points by their time coordinate
+  if(net.get<int>("causal") && !net.get<int>("transient"))
+  {
+    errors.push_back("net: causal weighting needs transient 1");
+  }
+  //- symmetry plane has to be the centre of the box
+  if(mesh.get<int>("symmetry"))
+  {
+    float xc = mesh.get<float>("xc");
+    float centre = 0.5*(mesh.get<float>("lbX") + mesh.get<float>("ubX"));
+    if(std::abs(xc - centre) > 0.5*mesh.get<float>("dx"))
+    {
+      errors.push_back("mesh: symmetry needs xc at the centre of lbX..ubX");
+    }
+    //- an interior sub-box edge at xc would be taken for the plane
+    if(decomposed)
+    {
+      errors.push_back("mesh: symmetry is not supported with nSubX/nSubY > 1");
+    }
+  }
+  //- fdTerms is a comma separated list of loss term names
+  {
+    std::stringstream ss(net.get<std::string>("fdTerms"));
+    std::string term;
+    const std::vector<std::string> fdChoices = {"none","Mass","MomX","MomY","CH","MU"};
+    while(std::getline(ss,term,','))
+    {
+      if(std::find(fdChoices.begin(),fdChoices.end(),term) == fdChoices.end())
+      {
+        errors.push_back("net: unknown fdTerms entry " + term);
+      }
+    }
+  }
+  if(!errors.empty())
+  {
+    std::cerr<<"Invalid configuration:\n";
+    for(const std::string &error : errors)
+    {
+      std::cerr<<"  "<<error<<"\n";
+    }
+    std::exit(EXIT_FAILURE);
+  }
+  //- symmetry reduced domain, same point density as the full box so that
+  //- an epoch costs the reduced fraction of the full one, batch sizes 
+  //- follow so the number of batches per epoch stays the same, NBC is per
+  //- wall and the side walls keep their length
+  if(mesh.get<int>("symmetry"))
+  {
+    float fraction = (mesh.get<float>("ubX") - mesh.get<float>("xc"))/
+      (mesh.get<float>("ubX") - mesh.get<float>("lbX"));
+    for(const std::string key : {"NEQN","NIC","BATCHSIZE"})
+    {
+      int value = net.get<int>(key);
+      net.set(key,std::to_string(int(std::round(fraction*value))));
+    }
+  }
+  //- typed settings, parsed once
+  runtime_.debug = runtime.get<int>("DEBUG");
+  runtime_.infoInterval = runtime.get<int>("infoInterval");
+  runtime_.saveInterval = runtime.get<int>("saveInterval");
+  runtime_.benchmark = runtime.get<int>("benchmark");
+  runtime_.benchmarkSteps = runtime.get<int>("benchmarkSteps");
+  runtime_.metrics = runtime.get<int>("metrics");
+  runtime_.metricsFlush = runtime.get<int>("metricsFlush");
+  runtime_.metricsFile = runtime.get<std::string>("metricsFile");
+  runtime_.autoTune = runtime.get<int>("autoTune");
+  runtime_.autoTuneSteps = runtime.get<int>("autoTuneSteps");
+  runtime_.memoryBudgetMB = runtime.get<int>("memoryBudgetMB");
+  runtime_.autoTuneFile = runtime.get<std::string>("autoTuneFile");
+  thermo_.Mo = thermo.get<float>("Mo");
+  thermo_.epsilon = thermo.get<float>("epsilon");
+  thermo_.sigma0 = thermo.get<float>("sigma0");
+  thermo_.rhoL = thermo.get<float>("rhoL");
+  thermo_.muL = thermo.get<float>("muL");
+  thermo_.rhoG = thermo.get<float>("rhoG");
+  thermo_.muG = thermo.get<float>("muG");
+  thermo_.epsilonStart = thermo.get<float>("epsilonStart");
+  thermo_.epsilonFactor = thermo.get<float>("epsilonFactor");
+  optim_.lRate = optim.get<float>("lRate");
+  optim_.lRateDecay = optim.get<float>("lRateDecay");
+  optim_.lRateEpochs = optim.get<int>("lRateEpochs");
+}
+
+Dictionary* caseConfig::section(const std::string &name)
+{
+  if(name == "runtime") return &runtime;
+  if(name == "mesh") return &mesh;
+  if(name == "net") return &net;
+  if(name == "thermo") return &thermo;
+  if(name == "optim") return &optim;
+  return nullptr;
+}
+
+//- check every key against the schema and fill in defaults
+void caseConfig::validate
+(
+  const std::string &name,
+  Dictionary &dict,
+  const std::vector<configKey> &schema,
+  std::vector<std::string> &errors
+)
+{
+  //- unknown keys, most likely typos
+  for(const std::string &key : dict.keys())
+  {
+    bool known = std::any_of
+    (
+      schema.begin(),schema.end(),
+      [&key](const configKey &entry){return entry.key == key;}
+    );
+    if(!known)
+    {
+      errors.push_back("[" + name + "] unknown key " + key);
+    }
+  }
+  for(const configKey &entry : schema)
+  {
+    if(!dict.found(entry.key))
+    {
+      if(entry.required)
+      {
+        errors.push_back("[" + name + "] missing required key " + entry.key);
+      }
+      else if(!entry.defaultValue.empty())
+      {
+        dict.set(entry.key,entry.defaultValue);
+        defaulted_.push_back(name + "." + entry.key);
+      }
+      continue;
+    }
+    std::string value = dict.get<std::string>(entry.key);
+    if(entry.type == 's')
+    {
+      if
+      (
+        !entry.choices.empty() && 
+        std::find(entry.choices.begin(),entry.choices.end(),value) == entry.choices.end()
+      )
+      {
+        errors.push_back("[" + name + "] invalid value " + value + " for " + entry.key);
+      }
+      continue;
+    }
+    double number;
+    if(!parseNumber(value,entry.type,number))
+    {
+      errors.push_back
+      (
+        "[" + name + "] " + entry.key + " = " + value + " is not " + 
+        (entry.type == 'i' ? "an integer" : "a number")
+      );
+    }
+    else if(number < entry.min || number > entry.max)
+    {
+      errors.push_back("[" + name + "] " + entry.key + " = " + value + " out of bounds");
+    }
+  }
+}
+
+//- info out resolved configuration
+void caseConfig::print() const
+{
+  std::cout<<"Configuration ("<<fileName_<<"):\n";
+  for(const std::string &name : sectionNames)
+  {
+    const Dictionary &dict = 
+      (name == "runtime") ? runtime : (name == "mesh") ? mesh : 
+      (name == "net") ? net : (name == "thermo") ? thermo : optim;
+    std::cout<<"["<<name<<"]\n";
+    for(const configKey &entry : schemaOf(name))
+    {
+      if(!dict.found(entry.key))
+      {
+        continue;
+      }
+      std::string id = name + "." + entry.key;
+      std::cout<<"  "<<std::left<<std::setw(18)<<entry.key
+        <<dict.get<std::string>(entry.key);
+      if(std::find(overrides_.begin(),overrides_.end(),id) != overrides_.end())
+      {
+        std::cout<<"  (command line)";
+      }
+      else if(std::find(defaulted_.begin(),defaulted_.end(),id) != defaulted_.end())
+      {
+        std::cout<<"  (default)";
+      }
+      std::cout<<"\n";
+    }
+  }
+  std::cout<<std::right;
+}
@@ -0,0 +1,289 @@
+#include "../include/decomposition.h"
+#include "../include/ch.h"
+#include <algorithm>
+//--------------------------subDomain definitions----------------------------//
+
+//- construct net, mesh and optimizer of a sub-domain
+subDomain::subDomain
+(
+  Dictionary &meshDict,
+  Dictionary &netDict,
+  float lRate,
+  torch::Device &device,
+  thermoPhysical &thermo,
+  float lbX,
+  float ubX,
+  float lbY,
+  float ubY
+)
+:
+  net_(netDict),
+  netPrev_(netDict),
+  loss_(0.0)
+{
+  net_->to(device);
+  netPrev_->to(device);
+  mesh_ = std::make_unique<mesh2D>
+  (
+    meshDict,net_,netPrev_,device,thermo,lbX,ubX,lbY,ubY
+  );
+  optim_ = std::make_unique<torch::optim::Adam>
+  (
+    net_->parameters(),
+    torch::optim::AdamOptions(lRate)
+  );
+}
+
+//- same batch loop as the closure in main, plus interface losses
+float subDomain::trainEpoch
+(
+  const std::vector<subDomainInterface> &interfaces,
+  int index,
+  float weight
+)
+{
+  float totalLoss = 0.0;
+  for(int i=0;i<net_->NITER_;i++)
+  {
+    mesh_->update(i);
+    std::vector<torch::Tensor> trainTerms;
+    //- plain terms for the stop test, weighted terms for the gradient
+    torch::Tensor plain = 
+      CahnHillard::loss(CahnHillard::lossTerms(*mesh_,trainTerms));
+    torch::Tensor loss = CahnHillard::loss(trainTerms);
+    torch::Tensor interfaceLoss = torch::zeros({},loss.options());
+    for(const subDomainInterface &face : interfaces)
+    {
+      if(face.a == index || face.b == index)
+      {
+        torch::Tensor fields = net_->forward(face.points_);
+        interfaceLoss = 
+          interfaceLoss + weight*torch::mse_loss(fields,face.target_);
+      }
+    }
+    loss = loss + interfaceLoss;
+    loss.backward();
+    totalLoss += (plain + interfaceLoss).item<float>();
+  }
+  optim_->step();
+  optim_->zero_grad();
+  loss_ = totalLoss/net_->NITER_;
+  return loss_;
+}
+
+//----------------------domainDecomposition definitions----------------------//
+
+//- split the box into sub-domains and set up the interfaces
+domainDecomposition::domainDecomposition
+(
+  Dictionary &meshDict,
+  Dictionary &netDict,
+  const optimConfig &optim,
+  torch::Device &device,
+  thermoPhysical &thermo
+)
+:
+  nSubX_(meshDict.lookupOrDefault<int>("nSubX",1)),
+  nSubY_(meshDict.lookupOrDefault<int>("nSubY",1)),
+  lbX_(meshDict.get<float>("lbX")),
+  ubX_(meshDict.get<float>("ubX")),
+  lbY_(meshDict.get<float>("lbY")),
+  ubY_(meshDict.get<float>("ubY")),
+  nInterface_(meshDict.lookupOrDefault<int>("nInterface",100)),
+  interfaceWeight_(meshDict.lookupOrDefault<float>("interfaceWeight",1.0))
+{
+  if(!active())
+  {
+    return;
+  }
+  const float stepSize = meshDict.get<float>("stepSize");
+  endTime_ = meshDict.lookupOrDefault<float>
+  (
+    "endTime",meshDict.get<float>("lbT") + 3*stepSize
+  );
+  //- sub-domain bounds, outer bounds taken as is so the walls are detected
+  std::vector<float> xb(nSubX_ + 1);
+  std::vector<float> yb(nSubY_ + 1);
+  for(int i=0;i<=nSubX_;i++)
+  {
+    xb[i] = (i == nSubX_) ? ubX_ : lbX_ + i*(ubX_ - lbX_)/nSubX_;
+  }
+  for(int j=0;j<=nSubY_;j++)
+  {
+    yb[j] = (j == nSubY_) ? ubY_ : lbY_ + j*(ubY_ - lbY_)/nSubY_;
+  }
+  for(int i=0;i<nSubX_;i++)
+  {
+    for(int j=0;j<nSubY_;j++)
+    {
+      sub_.push_back
+      (
+        std::make_unique<subDomain>
+        (
+          meshDict,netDict,optim.lRate,device,thermo,xb[i],xb[i+1],yb[j],yb[j+1]
+        )
+      );
+      //- interface with the right neighbour
+      if(i < nSubX_ - 1)
+      {
+        subDomainInterface face;
+        face.a = i*nSubY_ + j;
+        face.b = (i + 1)*nSubY_ + j;
+        face.dim = 0;
+        face.position = xb[i+1];
+        face.lb = yb[j];
+        face.ub = yb[j+1];
+        interfaces_.push_back(face);
+      }
+      //- interface with the top neighbour
+      if(j < nSubY_ - 1)
+      {
+        subDomainInterface face;
+        face.a = i*nSubY_ + j;
+        face.b = i*nSubY_ + j + 1;
+        face.dim = 1;
+        face.position = yb[j+1];
+        face.lb = xb[i];
+        face.ub = xb[i+1];
+        interfaces_.push_back(face);
+      }
+    }
+  }
+  //- share the cores between the sub-domain threads
+  int nThreads = std::thread::hardware_concurrency();
+  torch::set_num_threads(std::max(1,nThreads/int(sub_.size())));
+  std::cout<<"Domain decomposed into "<<sub_.size()<<" sub-domains with "
+    <<interfaces_.size()<<" interfaces\n";
+  for(int s=0;s<sub_.size();s++)
+  {
+    workers_.emplace_back(&domainDecomposition::work,this,s);
+  }
+}
+
+//- wake the workers up with the stop flag set and wait for them
+domainDecomposition::~domainDecomposition()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for(std::thread &worker : workers_)
+  {
+    worker.join();
+  }
+}
+
+//- wait for the next epoch, train and report back
+void domainDecomposition::work(int s)
+{
+  int seen = 0;
+  while(true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock,[&]{return stop_ || generation_ != seen;});
+      if(stop_)
+      {
+        return;
+      }
+      seen = generation_;
+    }
+    sub_[s]->trainEpoch(interfaces_,s,interfaceWeight_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      nDone_++;
+    }
+    done_.notify_one();
+  }
+}
+
+bool domainDecomposition::active() const
+{
+  return nSubX_*nSubY_ > 1;
+}
+
+bool domainDecomposition::running() const
+{
+  const mesh2D &mesh = *sub_[0]->mesh_;
+  return mesh.lbT_ < endTime_ - 0.5*mesh.deltaT_;
+}
+
+//- new random interface points for this epoch, targets are the average of 
+//- both sides and are frozen while the sub-domains train
+void domainDecomposition::sampleInterfaces()
+{
+  torch::NoGradGuard no_grad;
+  for(subDomainInterface &face : interfaces_)
+  {
+    const mesh2D &mesh = *sub_[face.a]->mesh_;
+    torch::TensorOptions options = torch::TensorOptions().device(mesh.device_);
+    torch::Tensor along = face.lb + (face.ub - face.lb)*torch::rand({nInterface_},options);
+    torch::Tensor t = mesh.lbT_ + (mesh.ubT_ - mesh.lbT_)*torch::rand({nInterface_},options);
+    torch::Tensor normal = torch::full({nInterface_},face.position,options);
+    face.points_ = (face.dim == 0) ?
+      torch::stack({normal,along,t},1) : torch::stack({along,normal,t},1);
+    face.target_ = 0.5*
+    (
+      sub_[face.a]->net_->forward(face.points_) + 
+      sub_[face.b]->net_->forward(face.points_)
+    );
+  }
+}
+
+//- train all sub-domains concurrently on the worker threads
+float domainDecomposition::trainEpoch()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nDone_ = 0;
+    generation_++;
+  }
+  start_.notify_all();
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock,[&]{return nDone_ == int(sub_.size());});
+  }
+  float maxLoss = 0.0;
+  for(const auto &sub : sub_)
+  {
+    maxLoss = std::max(maxLoss,sub->loss_);
+  }
+  return maxLoss;
+}
+
+//- move all sub-domains to the next time window
+void domainDecomposition::advance()
+{
+  for(auto &sub : sub_)
+  {
+    sub->mesh_->updateMesh();
+    sub->net_->reset_layers();
+  }
+}
+
+//- evaluate every point with the net of the sub-domain containing it
+torch::Tensor domainDecomposition::predict(const torch::Tensor &X)
+{
+  torch::NoGradGuard no_grad;
+  torch::Tensor x = X.index({Slice(),0});
+  torch::Tensor y = X.index({Slice(),1});
+  torch::Tensor ix = torch::floor((x - lbX_)/(ubX_ - lbX_)*nSubX_).clamp(0,nSubX_ - 1);
+  torch::Tensor iy = torch::floor((y - lbY_)/(ubY_ - lbY_)*nSubY_).clamp(0,nSubY_ - 1);
+  torch::Tensor id = (ix*nSubY_ + iy).to(torch::kLong);
+  torch::Tensor fields = torch::zeros
+  (
+    {X.size(0),sub_[0]->net_->OUTPUT_DIM},
+    X.options()
+  );
+  for(int s=0;s<sub_.size();s++)
+  {
+    torch::Tensor idx = torch::nonzero(id == s).squeeze(1);
+    if(idx.numel() == 0)
+    {
+      continue;
+    }
+    fields.index_copy_(0,idx,sub_[s]->net_->forward(X.index_select(0,idx)));
+  }
+  return fields;
+}
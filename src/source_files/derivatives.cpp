@@ -1,7 +1,29 @@
 #include "../include/derivatives.h"
+#include <map>
 
 using namespace torch::indexing; 
 
+//- grad output of ones for the vector-Jacobian products, the shapes only 
+//- take a handful of values (batch, IC and BC sizes) so the tensors are 
+//- cached per shape instead of being allocated for every derivative, 
+//- they are never modified so sharing them between graphs is safe
+const torch::Tensor &onesLike(const torch::Tensor &I)
+{
+  thread_local std::map<std::vector<int64_t>, torch::Tensor> cache;
+  std::vector<int64_t> key = I.sizes().vec();
+  torch::Tensor &ones = cache[key];
+  if
+  (
+    !ones.defined() || 
+    ones.scalar_type() != I.scalar_type() ||
+    ones.device() != I.device()
+  )
+  {
+    ones = torch::ones_like(I);
+  }
+  return ones;
+}
+
 //- first order derivative
 torch::Tensor d_d1
 (
@@ -14,7 +36,7 @@ torch::Tensor d_d1
   (
     {I}, // predicted output from net
     {X}, // input features to get the prediction
-    {torch::ones_like(I)},
+    {onesLike(I)},
     true, // retain graph, lets us get higher order derivatives
     true, // create graph
     true // allow unused
@@ -32,7 +54,7 @@ torch::Tensor d_d1
   (
     {I},
     {X},
-    {torch::ones_like(I)},
+    {onesLike(I)},
     true,
     true,
     true
@@ -0,0 +1,129 @@
+#include "../include/initialCondition.h"
+#include "../include/mesh.h"
+#include <cstdlib>
+//------------------------analyticBubble definitions-------------------------//
+
+analyticBubble::analyticBubble(float radius)
+:
+  radius_(radius)
+{}
+
+//- bubble at rest, tanh profile of the phase field across the interface
+torch::Tensor analyticBubble::evaluate
+(
+  const mesh2D &mesh,
+  const torch::Tensor &X
+) const
+{
+  const float &e = mesh.thermo_.epsilon;
+  const torch::Tensor &x = X.index({Slice(),0});
+  const torch::Tensor &y = X.index({Slice(),1});
+  torch::Tensor C = torch::tanh
+  (
+    (torch::sqrt(torch::pow(x - mesh.xc, 2) + torch::pow(y - mesh.yc, 2)) - radius_)
+    /(1.41421356237 * e)
+  );
+  torch::Tensor zero = torch::zeros_like(C);
+  return torch::stack({zero,zero,zero,C},1);
+}
+
+//-------------------------previousNet definitions---------------------------//
+
+//- predictions of the previous converged net
+torch::Tensor previousNet::evaluate
+(
+  const mesh2D &mesh,
+  const torch::Tensor &X
+) const
+{
+  //- disable gradient tracking so optim steps don't update netPrev parameters
+  torch::NoGradGuard no_grad;
+  return mesh.netPrev_->forward(X).slice(1,0,4);
+}
+
+//--------------------------fieldFile definitions----------------------------//
+
+//- read in field file and arrange it on its (x, y) lattice
+fieldFile::fieldFile
+(
+  const std::string &fileName,
+  const torch::Device &device
+)
+{
+  std::vector<std::vector<float>> rows = readIn<float>(fileName,6,' ');
+  const int64_t n = rows.size();
+  torch::Tensor data = torch::empty({n,6});
+  auto a = data.accessor<float,2>();
+  for(int64_t i=0;i<n;i++)
+  {
+    for(int j=0;j<6;j++)
+    {
+      a[i][j] = rows[i][j];
+    }
+  }
+  //- lattice index of every row
+  auto [xs, ix] = torch::_unique(data.index({Slice(),0}),true,true);
+  auto [ys, iy] = torch::_unique(data.index({Slice(),1}),true,true);
+  const int64_t nX = xs.numel();
+  const int64_t nY = ys.numel();
+  if(n == 0 || nX*nY != n)
+  {
+    std::cerr<<"Initial condition file "<<fileName
+      <<" is not a structured (x, y) lattice\n";
+    std::exit(EXIT_FAILURE);
+  }
+  lbX_ = xs[0].item<float>();
+  ubX_ = xs[nX - 1].item<float>();
+  lbY_ = ys[0].item<float>();
+  ubY_ = ys[nY - 1].item<float>();
+  torch::Tensor image = torch::zeros({4,nY,nX});
+  image.index_put_({Slice(),iy,ix},data.slice(1,2,6).t());
+  image_ = image.unsqueeze(0).to(device);
+}
+
+//- bilinear interpolation of the file fields onto X
+torch::Tensor fieldFile::evaluate
+(
+  const mesh2D &mesh,
+  const torch::Tensor &X
+) const
+{
+  namespace F = torch::nn::functional;
+  //- normalized sampling coordinates in [-1, 1]
+  torch::Tensor gx = 2*(X.index({Slice(),0}) - lbX_)/(ubX_ - lbX_) - 1;
+  torch::Tensor gy = 2*(X.index({Slice(),1}) - lbY_)/(ubY_ - lbY_) - 1;
+  torch::Tensor grid = torch::stack({gx,gy},1).view({1,1,-1,2});
+  torch::Tensor fields = F::grid_sample
+  (
+    image_,
+    grid,
+    F::GridSampleFuncOptions()
+      .mode(torch::kBilinear)
+      .padding_mode(torch::kBorder)
+      .align_corners(true)
+  );
+  //- (1 x 4 x 1 x N) -> (N x 4)
+  return fields.view({4,-1}).t();
+}
+
+//- create initial condition for the first time window
+std::shared_ptr<initialCondition> makeInitialCondition
+(
+  const Dictionary &dict,
+  const torch::Device &device
+)
+{
+  std::string type = dict.lookupOrDefault<std::string>("icType","analytic");
+  if(type == "file")
+  {
+    return std::make_shared<fieldFile>(dict.get<std::string>("icFile"),device);
+  }
+  if(type != "analytic")
+  {
+    std::cerr<<"Unknown icType: "<<type<<", using analytic bubble\n";
+  }
+  return std::make_shared<analyticBubble>
+  (
+    dict.lookupOrDefault<float>("radius",0.15)
+  );
+}
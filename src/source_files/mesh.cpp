@@ -1,5 +1,6 @@
 #include "../include/mesh.h"
 #include "../include/pinn.h"
+#include <cmath>
 //- construct computational domain for the PINN instance
 mesh2D::mesh2D
 (
@@ -8,16 +9,46 @@ mesh2D::mesh2D
   PinNet &netPrev,
   torch::Device &device, // device info
   thermoPhysical &thermo
+):
+  mesh2D
+  (
+    meshDict,
+    net,
+    netPrev,
+    device,
+    thermo,
+    //- read in spatial bounds from dict, symmetric cases only keep x >= xc
+    meshDict.lookupOrDefault<int>("symmetry",0) ? 
+      meshDict.get<float>("xc") : meshDict.get<float>("lbX"),
+    meshDict.get<float>("ubX"),
+    meshDict.get<float>("lbY"),
+    meshDict.get<float>("ubY")
+  )
+{}
+
+//- construct computational domain for a sub-box of the domain in the dict,
+//- sides of the sub-box inside the domain are not walls
+mesh2D::mesh2D
+(
+  Dictionary &meshDict, //mesh parameters
+  PinNet &net,
+  PinNet &netPrev,
+  torch::Device &device, // device info
+  thermoPhysical &thermo,
+  float lbX,
+  float ubX,
+  float lbY,
+  float ubY
 ):
   net_(net), // pass in current neural net
   netPrev_(netPrev), // pass in other neural net
   dict(meshDict),
   device_(device), // pass in device info
   thermo_(thermo), // pass in thermo class instance
-  lbX_(dict.get<float>("lbX")), // read in mesh props from dict
-  ubX_(dict.get<float>("ubX")),
-  lbY_(dict.get<float>("lbY")),
-  ubY_(dict.get<float>("ubY")),
+  lbX_(lbX), 
+  ubX_(ubX),
+  lbY_(lbY),
+  ubY_(ubY),
   lbT_(dict.get<float>("lbT")),
   ubT_(dict.get<float>("ubT")),
   deltaX_(dict.get<float>("dx")),
@@ -28,6 +59,17 @@ mesh2D::mesh2D
 
 {
   TimeStep_ = dict.get<float>("stepSize");
+  startTime_ = lbT_;
+  //- interface-aware sampling of the PDE points
+  interfaceFraction_ = dict.lookupOrDefault<float>("interfaceFraction",0.0);
+  interfaceDelta_ = dict.lookupOrDefault<float>("interfaceDelta",0.1);
+  //- sides that coincide with the bounds of the tank are walls
+  leftIsWall_ = lbX_ == dict.get<float>("lbX");
+  //- left side on the symmetry plane x = xc of a mirror symmetric case
+  leftIsSymmetry_ = dict.lookupOrDefault<int>("symmetry",0) && lbX_ == xc;
+  rightIsWall_ = ubX_ == dict.get<float>("ubX");
+  bottomIsWall_ = lbY_ == dict.get<float>("lbY");
+  topIsWall_ = ubY_ == dict.get<float>("ubY");
     //- get number of ponits from bounds and step size
   Nx_ = (ubX_ - lbX_)/deltaX_ + 1;
   Ny_ = (ubY_ - lbY_)/deltaY_ + 1;
@@ -46,8 +88,32 @@ mesh2D::mesh2D
   //- tensor to pass for converged neural net
   xy = torch::stack({xyGrid[0].flatten(),xyGrid[1].flatten()},1);
   xy.set_requires_grad(true);
+  //- flat parameter storage, both nets share the layout so that 
+  //- loadState is a single copy
+  if(net_->flatParams_)
+  {
+    net_->flatten();
+    netPrev_->flatten();
+  }
+  //- normalization of the net inputs
+  net_->setInputBounds({lbX_,lbY_,lbT_},{ubX_,ubY_,ubT_});
+  //- walls of the hard boundary constraints, same for both nets,
+  //- u = 0 on the symmetry plane as well
+  bool leftU = leftIsWall_ || leftIsSymmetry_;
+  net_->setWalls
+  (
+    lbX_,ubX_,lbY_,ubY_,leftU,rightIsWall_,bottomIsWall_,topIsWall_
+  );
+  netPrev_->setWalls
+  (
+    lbX_,ubX_,lbY_,ubY_,leftU,rightIsWall_,bottomIsWall_,topIsWall_
+  );
   //- create boundary grids
   createBC();
+  //- initial conditions for first and later time windows
+  firstIC_ = makeInitialCondition(dict,device_);
+  prevIC_ = std::make_shared<previousNet>();
+  updateICTable();
 }
 
 //- operator overload () to acess main computational domain
@@ -66,6 +132,8 @@ torch::Tensor  mesh2D::operator()(int i, int j, int k)
 //- create boundary grids
 void mesh2D::createBC()
 {
+  //- grids are rebuilt, drop flattened copies
+  flatGrids_.clear();
   
   torch::Tensor xLeft = torch::tensor(lbX_,device_);
   torch::Tensor xRight = torch::tensor(ubX_,device_);
@@ -98,7 +166,7 @@ void mesh2D::getOutputMesh()
   tGrid = torch::linspace(lbT_, ubT_, Nt_/2,device_);
   //- construct entire mesh domain for transient 2D simulations
   mesh_ = torch::meshgrid({xGrid,yGrid,tGrid});
- 
+  flatGrids_.clear();
 }
 
 //- general method to create samples
@@ -117,6 +185,12 @@ void mesh2D::createSamples
   //- random indices for PDE loss
   torch::Tensor indices = torch::randperm
   (ntotal,device_).slice(0,0,nSamples);
+  //- refill preallocated samples in place
+  if(net_->graphReuse_)
+  {
+    fillSamples(flatGrid(grid),samples,indices);
+    return;
+  }
   
   //- push vectors to vectors stack
   for(int i=0;i<grid.size();i++)
@@ -177,8 +251,14 @@ void mesh2D::createTotalSamples
   {
     if(net_->transient_ == 1)
     {
-      //- update samples for intialGrid
-      createSamples(initialGrid_,iIC_,net_->N_IC);
+      //- update samples for intialGrid, targets are gathered from the table
+      icIndices_ = torch::randperm
+      (
+        icTable_.size(0),
+        torch::TensorOptions().dtype(torch::kLong).device(device_)
+      ).slice(0,0,net_->N_IC);
+      createSamples(initialGrid_,iIC_,icIndices_);
+      icTarget_ = icTable_.index_select(0,icIndices_);
     }
     //- update samples for left wall 
     createSamples(leftWall,iLeftWall_,net_->N_BC);
@@ -191,6 +271,29 @@ void mesh2D::createTotalSamples
   }
 }
 
+//- the stencils of all PDE points go through the net in one forward pass,
+//- no input gradients are needed, derivatives are differences of outputs
+void mesh2D::updateStencil()
+{
+  const float h = net_->FD_H;
+  const float k = net_->FD_HT;
+  //- offsets of the stencil points, same order as stencilPoint
+  const std::vector<float> offsets = 
+  {
+    0,0,0,
+    h,0,0, -h,0,0, 0,h,0, 0,-h,0,
+    2*h,0,0, -2*h,0,0, 0,2*h,0, 0,-2*h,0,
+    h,h,0, h,-h,0, -h,h,0, -h,-h,0,
+    0,0,k, 0,0,-k
+  };
+  const torch::Tensor X = iPDE_.detach();
+  const int64_t nDim = X.size(1);
+  torch::Tensor shift = torch::tensor(offsets).view({N_STENCIL,3})
+    .slice(1,0,nDim).to(X.device());
+  torch::Tensor XS = (X.unsqueeze(0) + shift.unsqueeze(1)).reshape({-1,nDim});
+  fieldsStencil_ = net_->forward(XS).view({N_STENCIL,X.size(0),-1});
+}
+
 //- forward pass of current batch in batch iteration loop
 //- update output features for each batch iteration,
 //- pass in the iteration 
@@ -199,17 +302,42 @@ void mesh2D::createTotalSamples
 void mesh2D::update(int iter)
 { 
   createTotalSamples(iter);
+  forward();
+}
+
+//- forward passes of the current samples, without resampling
+void mesh2D::forward()
+{
   // std::cout<<"updating solution fields\n";
   //- update all fields
   fieldsPDE_ = net_->forward(iPDE_);
+  //- stencil fields for finite difference residuals
+  if(net_->FD_TERMS != "none")
+  {
+    updateStencil();
+  }
   if(net_->transient_ == 1)
   { 
     fieldsIC_ = net_->forward(iIC_);
   }
-  fieldsLeft_ = net_->forward(iLeftWall_);
-  fieldsRight_ = net_->forward(iRightWall_);
-  fieldsBottom_ = net_->forward(iBottomWall_);
-  fieldsTop_ = net_->forward(iTopWall_);
+  //- boundary fields only needed on walls 
+  if(leftIsWall_ || leftIsSymmetry_)
+  {
+    fieldsLeft_ = net_->forward(iLeftWall_);
+  }
+  if(rightIsWall_)
+  {
+    fieldsRight_ = net_->forward(iRightWall_);
+  }
+  //- no-slip walls are satisfied exactly with hard constraints
+  if(bottomIsWall_ && !net_->hardBC_)
+  {
+    fieldsBottom_ = net_->forward(iBottomWall_);
+  }
+  if(topIsWall_ && !net_->hardBC_)
+  {
+    fieldsTop_ = net_->forward(iTopWall_);
+  }
 }
 
 //- creates indices tensor for iPDE
@@ -220,6 +348,31 @@ void mesh2D::createIndices()
     pdeIndices_ = 
       torch::randperm(xyGrid[0].numel(),device_).slice(0,0,net_->N_EQN,1);
   }
+  else if(interfaceFraction_ > 0 && bandIndices_.numel() > 0)
+  {
+    //- part of the points in the interface band at random time levels
+    const int64_t nBand = std::round(interfaceFraction_*net_->N_EQN);
+    torch::TensorOptions options = 
+      torch::TensorOptions().dtype(torch::kLong).device(device_);
+    //- band lattice points (spatial x time levels) without replacement if
+    //- the band holds enough of them, with replacement otherwise
+    const int64_t nBandLattice = bandIndices_.numel()*Nt_;
+    torch::Tensor band = (nBandLattice >= nBand) ?
+      torch::randperm(nBandLattice,options).slice(0,0,nBand,1) :
+      torch::randint(nBandLattice,{nBand},options);
+    torch::Tensor spatial = 
+      bandIndices_.index_select(0,torch::floor_divide(band,Nt_));
+    torch::Tensor time = torch::remainder(band,Nt_);
+    //- rest uniform over the lattice
+    torch::Tensor uniform = torch::randperm(mesh_[0].numel(),options)
+      .slice(0,0,net_->N_EQN - nBand,1);
+    //- shuffle so every batch gets its share of band points
+    pdeIndices_ = torch::cat({spatial*Nt_ + time,uniform}).index_select
+    (
+      0,
+      torch::randperm(net_->N_EQN,options)
+    );
+  }
   else
   {
     pdeIndices_ = 
@@ -238,6 +391,12 @@ void mesh2D::createSamples
  torch::Tensor &indices
 )
 {
+  //- refill preallocated samples in place
+  if(net_->graphReuse_)
+  {
+    fillSamples(flatGrid(grid),samples,indices);
+    return;
+  }
   //- vectors to stack
   std::vector<torch::Tensor> vectorStack;
   //- push vectors to vectors stack
@@ -257,23 +416,143 @@ void mesh2D::createSamples
   samples.set_requires_grad(true);
 }
 
+//- flattened copy (N x dim) of a grid, built once and cached until the 
+//- grids are rebuilt, avoids flattening the expanded meshgrid views of the
+//- complete lattice for every batch
+const torch::Tensor &mesh2D::flatGrid(const std::vector<torch::Tensor> &grid)
+{
+  auto it = flatGrids_.find(&grid);
+  if(it == flatGrids_.end())
+  {
+    std::vector<torch::Tensor> vectorStack;
+    for(int i=0;i<grid.size();i++)
+    {
+      vectorStack.push_back(torch::flatten(grid[i]));
+    }
+    it = flatGrids_.emplace(&grid,torch::stack(vectorStack,1)).first;
+  }
+  return it->second;
+}
+
+//- gather rows of a flattened grid into samples, the samples tensor is only 
+//- allocated when its shape changes and is refilled in place otherwise, 
+//- the graphs of the previous batch have been freed by backward at this point
+void mesh2D::fillSamples
+(
+  const torch::Tensor &flat,
+  torch::Tensor &samples,
+  const torch::Tensor &indices
+)
+{
+  if
+  (
+    !samples.defined() || samples.grad_fn() ||
+    samples.size(0) != indices.size(0) || samples.size(1) != flat.size(1)
+  )
+  {
+    samples = torch::empty({indices.size(0),flat.size(1)},flat.options());
+    samples.set_requires_grad(true);
+  }
+  torch::NoGradGuard no_grad;
+  torch::index_select_out(samples,flat,0,indices);
+  //- backward accumulates into the grad of the leaf, never read, drop it
+  //- so that it does not grow over the steps
+  samples.mutable_grad().reset();
+}
+
 void mesh2D::updateMesh()
 {
+  //- transfer over parameters of current converged net to 
+  //- previous net reference to use as intial condition for 
+  //- intial losses
+  loadState(net_, netPrev_);
   //- update the lower level of time grid
-  lbT_ = lbT_ + TimeStep_;
-  ubT_ = ubT_ + TimeStep_;
-  //- get new number of time steps in the current time domain
-  Nt_ = (ubT_ - lbT_)/deltaT_ + 1;
+  setWindow(lbT_ + TimeStep_, ubT_ + TimeStep_);
+}
+
+//- next window starts where the current one ends
+void mesh2D::advanceWindow(float stepSize)
+{
+  loadState(net_, netPrev_);
+  setWindow(ubT_, ubT_ + stepSize);
+}
+
+//- set time bounds and rebuild all grids depending on them
+void mesh2D::setWindow(float lbT, float ubT)
+{
+  lbT_ = lbT;
+  ubT_ = ubT;
+  //- get new number of time steps in the current time domain,
+  //- rounded since adaptive window sizes are not multiples of deltaT_
+  Nt_ = std::round((ubT_ - lbT_)/deltaT_) + 1;
+  Ntotal_ = Nx_*Ny_*Nt_;
   //- update tGrid
   tGrid = torch::linspace(lbT_, ubT_, Nt_,device_);
   //- update main mesh
   mesh_ = torch::meshgrid({xGrid,yGrid,tGrid});
+  //- only the trained net sees the new window, netPrev_ keeps the bounds
+  //- it was trained with
+  net_->setInputBounds({lbX_,lbY_,lbT_},{ubX_,ubY_,ubT_});
   //- update the boundary grids
   createBC();
-  //- transfer over parameters of current converged net to 
-  //- previous net reference to use as intial condition for 
-  //- intial losses
-  loadState(net_, netPrev_);
+  //- initial condition targets of the new window
+  updateICTable();
+}
+
+//- precompute initial condition targets, keeps the analytic expression 
+//- and netPrev_ forward passes out of the epoch loop
+void mesh2D::updateICTable()
+{
+  if(net_->transient_ == 0)
+  {
+    return;
+  }
+  torch::NoGradGuard no_grad;
+  torch::Tensor icGrid = torch::stack
+  (
+    {
+      torch::flatten(initialGrid_[0]),
+      torch::flatten(initialGrid_[1]),
+      torch::flatten(initialGrid_[2])
+    },1
+  );
+  const initialCondition &ic = (lbT_ == startTime_) ? *firstIC_ : *prevIC_;
+  icTable_ = ic.evaluate(*this,icGrid);
+  updateInterfaceBand();
+}
+
+//- full field from the half domain of a symmetric case, points with 
+//- x > xc are mirrored to 2*xc - x with u changing sign
+void mesh2D::mirror(torch::Tensor &grid, torch::Tensor &fields) const
+{
+  if(!leftIsSymmetry_)
+  {
+    return;
+  }
+  torch::NoGradGuard no_grad;
+  torch::Tensor inner = grid.index({Slice(),0}) > xc;
+  torch::Tensor mirrorGrid = grid.index({inner}).clone();
+  torch::Tensor mirrorFields = fields.index({inner}).clone();
+  mirrorGrid.index_put_({Slice(),0},2*xc - mirrorGrid.index({Slice(),0}));
+  mirrorFields.index_put_({Slice(),0},-mirrorFields.index({Slice(),0}));
+  grid = torch::cat({mirrorGrid,grid});
+  fields = torch::cat({mirrorFields,fields.detach()});
+}
+
+//- the initial condition table already holds C of netPrev_ (or of the 
+//- initial condition) on the complete spatial lattice at the start of the 
+//- window, the band is taken from it without any extra forward pass, 
+//- icTable_ rows follow the flattened (x, y) lattice so row i is the 
+//- column of mesh_ points i*Nt_ + k
+void mesh2D::updateInterfaceBand()
+{
+  if(interfaceFraction_ <= 0)
+  {
+    return;
+  }
+  torch::NoGradGuard no_grad;
+  torch::Tensor C = icTable_.index({Slice(),3});
+  bandIndices_ = torch::nonzero(torch::abs(C) < 1 - interfaceDelta_).flatten();
 }
 
 //- transfers over learned parameters from one neural net isntance to another,
@@ -285,12 +564,32 @@ void mesh2D::updateMesh()
 void loadState(PinNet& net1, PinNet &net2)
 {
   torch::autograd::GradMode::set_enabled(false);
-  auto net2_params = net2->named_parameters();
-  auto net1_params = net1->named_parameters(true);
-  for(auto &param : net1_params)
+  bool flat = net1->flatParameters.defined() && net2->flatParameters.defined();
+  if(flat)
+  {
+    //- same flat layout, one copy for all parameters and one for buffers
+    net2->flatParameters.copy_(net1->flatParameters);
+    net2->flatBuffers.copy_(net1->flatBuffers);
+  }
+  else
   {
-    auto name = param.key();
-    net2_params[name].copy_(param.value());
+    auto net2_params = net2->named_parameters();
+    auto net1_params = net1->named_parameters(true);
+    for(auto &param : net1_params)
+    {
+      auto name = param.key();
+      net2_params[name].copy_(param.value());
+    }
+  }
+  //- buffers too, Fourier features of both nets must match
+  auto net2_buffers = net2->named_buffers();
+  for(auto &buffer : net1->named_buffers(true))
+  {
+    //- floating point buffers are already in the flat copy
+    if(!flat || !buffer.value().is_floating_point())
+    {
+      net2_buffers[buffer.key()].copy_(buffer.value());
+    }
   }
   torch::autograd::GradMode::set_enabled(true);
 } 
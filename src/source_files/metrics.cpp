@@ -0,0 +1,113 @@
+#include "../include/metrics.h"
+#include "../include/ch.h"
+#include <iomanip>
+//- construct from the runtime settings
+metricsLogger::metricsLogger(const runtimeConfig &config)
+:
+  active_(config.metrics),
+  flushInterval_(config.metricsFlush),
+  prefix_(config.metricsFile)
+{
+  buffer_.reserve(flushInterval_);
+}
+
+metricsLogger::~metricsLogger()
+{
+  close();
+}
+
+//- one file per window, named like the field output of the window
+void metricsLogger::open(float lbT, float ubT)
+{
+  if(!active_)
+  {
+    return;
+  }
+  close();
+  //- a window trained again (e.g. continuation stages) appends to its log
+  bool append = (lbT == lbT_ && ubT == ubT_);
+  lbT_ = lbT;
+  ubT_ = ubT;
+  file_.open
+  (
+    prefix_ + std::to_string(ubT) + ".csv",
+    append ? std::ios::app : std::ios::out
+  );
+  if(!file_.is_open())
+  {
+    std::cerr << "Error: Unable to open metrics file for writing." << std::endl;
+    return;
+  }
+  if(append)
+  {
+    return;
+  }
+  file_<<"# window "<<lbT<<" "<<ubT<<"\n";
+  file_<<"epoch,loss";
+  for(int k=0;k<CahnHillard::NTERMS;k++)
+  {
+    file_<<","<<CahnHillard::lossTermName(k);
+  }
+  file_<<",lRate,stepTime_ms,memory_MB\n";
+}
+
+//- buffer record, the file is only touched every flushInterval_ epochs
+void metricsLogger::record
+(
+  int epoch,
+  float loss,
+  const std::vector<float> &terms,
+  float lRate,
+  double stepTime,
+  size_t memory
+)
+{
+  if(!active_)
+  {
+    return;
+  }
+  buffer_.push_back({epoch,loss,terms,lRate,stepTime,memory});
+  if(static_cast<int>(buffer_.size()) >= flushInterval_)
+  {
+    flush();
+  }
+}
+
+void metricsLogger::flush()
+{
+  if(!file_.is_open())
+  {
+    buffer_.clear();
+    return;
+  }
+  file_<<std::setprecision(7);
+  for(const record_ &r : buffer_)
+  {
+    file_<<r.epoch<<","<<r.loss;
+    for(float term : r.terms)
+    {
+      file_<<","<<term;
+    }
+    file_<<","<<r.lRate<<","<<r.stepTime<<",";
+    if(r.memory == noMemory)
+    {
+      file_<<"n/a\n";
+    }
+    else
+    {
+      file_<<(r.memory/1048576.0)<<"\n";
+    }
+  }
+  //- flush so the log can be followed while the case runs
+  file_.flush();
+  buffer_.clear();
+}
+
+void metricsLogger::close()
+{
+  flush();
+  if(file_.is_open())
+  {
+    file_.close();
+  }
+}
@@ -5,11 +5,26 @@
 //- function to create layers present in the net
 void PinNetImpl::create_layers()
 {
+  //- input normalization, identity until the bounds are set
+  inputShift = register_buffer("input_shift",torch::zeros({INPUT_DIM}));
+  inputScale = register_buffer("input_scale",torch::ones({INPUT_DIM}));
+  //- random Fourier features, registered as buffer so they are saved
+  //  and copied with the net but never trained
+  int inputFeatures = INPUT_DIM;
+  if(FOURIER_FEATURES > 0)
+  {
+    fourierB = register_buffer
+    (
+      "fourier_B",
+      FOURIER_SCALE*torch::randn({FOURIER_FEATURES,INPUT_DIM})
+    );
+    inputFeatures += 2*FOURIER_FEATURES;
+  }
   //- register input layer 
   input = register_module
   (
     "fc_input",
-    torch::nn::Linear(INPUT_DIM,HIDDEN_LAYER_DIM)
+    torch::nn::Linear(inputFeatures,HIDDEN_LAYER_DIM)
   );
   // torch::nn::init::xavier_normal_(input->weight);
   //- register and  hidden layers 
@@ -26,31 +41,39 @@ void PinNetImpl::create_layers()
     );
 
     //- intialize network parameters
-    torch::nn::init::xavier_normal_(linear_layer->weight);
-    
-    //- populate sequential with layers
-    hidden_layers->push_back(linear_layer);
+    init_layer(linear_layer);
     
-    //- batch normalization layers 
-    std::string batchNormName = "fc_batchNorm" + std::to_string(i);
-    torch::nn::BatchNorm1d batchNormLayer = register_module
-    (
-      batchNormName,
-      torch::nn::BatchNorm1d(HIDDEN_LAYER_DIM)
-    );
+    //- populate with layers
+    hidden_layers.push_back(linear_layer);
     
-    //- push back batch-normalization layer
-    hidden_layers->push_back(batchNormLayer);
-
-    //- create and register activation functions 
-    hidden_layers->push_back
-    (
-      register_module
+    //- normalization layers 
+    if(NORMALIZATION == "batchNorm")
+    {
+      std::string batchNormName = "fc_batchNorm" + std::to_string(i);
+      batchNorm_layers.push_back
       (
-        "fc_silu_hidden" + std::to_string(i), 
-        torch::nn::SiLU() // swish function X * RELU(X)
-      )
-    );
+        register_module
+        (
+          batchNormName,
+          torch::nn::BatchNorm1d(HIDDEN_LAYER_DIM)
+        )
+      );
+    }
+    else if(NORMALIZATION == "layerNorm")
+    {
+      std::string layerNormName = "fc_layerNorm" + std::to_string(i);
+      layerNorm_layers.push_back
+      (
+        register_module
+        (
+          layerNormName,
+          torch::nn::LayerNorm
+          (
+            torch::nn::LayerNormOptions({HIDDEN_LAYER_DIM})
+          )
+        )
+      );
+    }
   }
 
   //- register output layer
@@ -61,21 +84,195 @@ void PinNetImpl::create_layers()
   );
 }
 
+//- initialize weights of a hidden layer with the selected scheme
+void PinNetImpl::init_layer(torch::nn::Linear &layer)
+{
+  if(INIT == "xavierNormal")
+  {
+    torch::nn::init::xavier_normal_(layer->weight);
+  }
+  else if(INIT == "xavierUniform")
+  {
+    torch::nn::init::xavier_uniform_(layer->weight);
+  }
+  else if(INIT == "kaimingNormal")
+  {
+    torch::nn::init::kaiming_normal_(layer->weight);
+  }
+  //- "default" keeps the initialization of torch::nn::Linear
+}
+
+//- activation function selected in the dictionary
+torch::Tensor PinNetImpl::activate(const torch::Tensor &X) const
+{
+  if(ACTIVATION == "tanh")
+  {
+    return torch::tanh(X);
+  }
+  if(ACTIVATION == "gelu")
+  {
+    return torch::gelu(X);
+  }
+  if(ACTIVATION == "sin")
+  {
+    return torch::sin(X);
+  }
+  // swish function X * sigmoid(X)
+  return torch::silu(X);
+}
+
+//- map inputs onto [-1,1], differentiable so derivatives wrt the input 
+//  stay physical
+torch::Tensor PinNetImpl::normalize(const torch::Tensor &X) const
+{
+  if(!normalizeInput_)
+  {
+    return X;
+  }
+  return (X - inputShift)*inputScale;
+}
+
+//- set centre and scale of the normalization from the bounds of the domain
+void PinNetImpl::setInputBounds
+(
+  const std::vector<float> &lb,
+  const std::vector<float> &ub
+)
+{
+  torch::NoGradGuard no_grad;
+  std::vector<float> shift(INPUT_DIM,0.0);
+  std::vector<float> scale(INPUT_DIM,1.0);
+  for(int i=0;i<INPUT_DIM;i++)
+  {
+    shift[i] = 0.5*(lb[i] + ub[i]);
+    //- degenerate direction (single time level) is only shifted
+    if(ub[i] > lb[i])
+    {
+      scale[i] = 2.0/(ub[i] - lb[i]);
+    }
+  }
+  inputShift.copy_(torch::tensor(shift));
+  inputScale.copy_(torch::tensor(scale));
+}
+
+//- copy tensors into one contiguous buffer and let them point into it, 
+//  set_data keeps the tensor objects so module members, optimizers and 
+//  registered names stay valid
+static torch::Tensor pack(std::vector<torch::Tensor> tensors)
+{
+  std::vector<torch::Tensor> flat;
+  for(const torch::Tensor &t : tensors)
+  {
+    flat.push_back(t.reshape(-1));
+  }
+  torch::Tensor buffer = torch::cat(flat);
+  int64_t offset = 0;
+  for(torch::Tensor &t : tensors)
+  {
+    t.set_data(buffer.slice(0,offset,offset + t.numel()).view_as(t));
+    offset += t.numel();
+  }
+  return buffer;
+}
+
+//- flat parameter and buffer storage, integer buffers (batch norm
+//  counters) are left as they are
+void PinNetImpl::flatten()
+{
+  torch::NoGradGuard no_grad;
+  flatParameters = pack(parameters());
+  std::vector<torch::Tensor> buffersFloat;
+  for(const torch::Tensor &buffer : buffers())
+  {
+    if(buffer.is_floating_point())
+    {
+      buffersFloat.push_back(buffer);
+    }
+  }
+  flatBuffers = pack(buffersFloat);
+}
+
+//- set box of the hard boundary constraints, only sides that are walls 
+//  get a distance function
+void PinNetImpl::setWalls
+(
+  float lbX, float ubX, float lbY, float ubY,
+  bool left, bool right, bool bottom, bool top
+)
+{
+  wallLbX_ = lbX;
+  wallUbX_ = ubX;
+  wallLbY_ = lbY;
+  wallUbY_ = ubY;
+  leftWall_ = left;
+  rightWall_ = right;
+  bottomWall_ = bottom;
+  topWall_ = top;
+}
+
+//- output transform for the wall conditions, with distance functions
+//  scaled to [0,1]:
+//    u = dX*dY*u_net, zero on slip side walls and no-slip top/bottom walls
+//    v = dY*v_net, zero on no-slip top/bottom walls
+//  dv/dx = 0 on the side walls stays in the boundary loss
+torch::Tensor PinNetImpl::applyWalls
+(
+  const torch::Tensor &X,
+  const torch::Tensor &Y
+) const
+{
+  const torch::Tensor x = X.index({Slice(),0});
+  const torch::Tensor y = X.index({Slice(),1});
+  torch::Tensor dX = torch::ones_like(x);
+  torch::Tensor dY = torch::ones_like(y);
+  if(leftWall_)
+  {
+    dX = dX*(x - wallLbX_)/(wallUbX_ - wallLbX_);
+  }
+  if(rightWall_)
+  {
+    dX = dX*(wallUbX_ - x)/(wallUbX_ - wallLbX_);
+  }
+  if(bottomWall_)
+  {
+    dY = dY*(y - wallLbY_)/(wallUbY_ - wallLbY_);
+  }
+  if(topWall_)
+  {
+    dY = dY*(wallUbY_ - y)/(wallUbY_ - wallLbY_);
+  }
+  torch::Tensor u = Y.index({Slice(),0})*dX*dY;
+  torch::Tensor v = Y.index({Slice(),1})*dY;
+  return torch::cat
+  (
+    {u.unsqueeze(1),v.unsqueeze(1),Y.index({Slice(),Slice(2,None)})},1
+  );
+}
+
+//- Fourier feature embedding [X, sin(2 pi X B^T), cos(2 pi X B^T)]
+torch::Tensor PinNetImpl::embed(const torch::Tensor &X) const
+{
+  if(FOURIER_FEATURES == 0)
+  {
+    return X;
+  }
+  torch::Tensor XB = 2.0*M_PI*torch::matmul(X,fourierB.t());
+  return torch::cat({X,torch::sin(XB),torch::cos(XB)},1);
+}
+
 //- resets all the layers in the neural net class instance
-//  without needing to reconstruct the net class instance
+//  without needing to reconstruct the net class instance, later windows
+//  start from the default torch::nn::Linear init as before, the init 
+//  scheme only applies to the construction of the net
 void PinNetImpl::reset_layers()
 {
   //- reset the parameters for the input and output layers
   input->reset_parameters();
   output->reset_parameters();
-  //- loop through all the layers in sequential
-  for(int i=0;i<hidden_layers->size();i++)
+  //- loop through all the hidden layers
+  for(int i=0;i<hidden_layers.size();i++)
   {
-    //- check if the layer being iterated is a linear layer or not
-    if (auto linear_layer = dynamic_cast<torch::nn::LinearImpl*>(hidden_layers[i].get()))
-    {
-      hidden_layers[i]->as<torch::nn::Linear>()->reset_parameters();
-    }
+    hidden_layers[i]->reset_parameters();
   }
 }
 
@@ -98,6 +295,12 @@ PinNetImpl::PinNetImpl
   N_IC = dict.get<int>("NIC");
   //- flag for transient or steady state mode
   transient_ = dict.get<int>("transient");
+  //- causal training within time window
+  causal_ = dict.lookupOrDefault<int>("causal",0);
+  N_CAUSAL_BINS = dict.lookupOrDefault<int>("causalBins",10);
+  CAUSAL_EPS = dict.lookupOrDefault<float>("causalEps",1.0);
+  //- refill input buffers in place instead of reallocating them
+  graphReuse_ = dict.lookupOrDefault<int>("graphReuse",0);
   //- get target loss from dict
   ABS_TOL = dict.get<float>("ABSTOL");
   K_EPOCH = dict.get<int>("KEPOCH");
@@ -105,6 +308,26 @@ PinNetImpl::PinNetImpl
   BATCHSIZE=dict.get<int>("BATCHSIZE");
   //- number of iterations in one epoch 
   NITER_ = N_EQN/BATCHSIZE;
+  //- parameters as views into one flat buffer
+  flatParams_ = dict.lookupOrDefault<int>("flatParams",0);
+  //- normalize inputs with the bounds of the domain
+  normalizeInput_ = dict.lookupOrDefault<int>("normalizeInput",0);
+  //- finite difference residuals
+  FD_TERMS = dict.lookupOrDefault<std::string>("fdTerms","none");
+  FD_H = dict.lookupOrDefault<float>("fdH",1e-2);
+  FD_HT = dict.lookupOrDefault<float>("fdHt",1e-2);
+  //- chemical potential as output of the net
+  mixed_ = dict.lookupOrDefault<int>("mixed",0);
+  //- wall conditions by construction
+  hardBC_ = dict.lookupOrDefault<int>("hardBC",0);
+  //- architecture of the net
+  ACTIVATION = dict.lookupOrDefault<std::string>("activation","silu");
+  NORMALIZATION = 
+    dict.lookupOrDefault<std::string>("normalization","batchNorm");
+  residual_ = dict.lookupOrDefault<int>("residual",0);
+  FOURIER_FEATURES = dict.lookupOrDefault<int>("fourierFeatures",0);
+  FOURIER_SCALE = dict.lookupOrDefault<float>("fourierScale",1.0);
+  INIT = dict.lookupOrDefault<std::string>("init","xavierNormal");
   //- create and intialize the layers in the net
   create_layers();
 }
@@ -115,8 +338,26 @@ torch::Tensor PinNetImpl::forward
  const torch::Tensor& X
 )
 {
-  torch::Tensor I = torch::silu(input(X));
-  I = hidden_layers->forward(I);
+  torch::Tensor I = activate(input(embed(normalize(X))));
+  for(int i=0;i<hidden_layers.size();i++)
+  {
+    torch::Tensor H = hidden_layers[i](I);
+    if(!batchNorm_layers.empty())
+    {
+      H = batchNorm_layers[i](H);
+    }
+    else if(!layerNorm_layers.empty())
+    {
+      H = layerNorm_layers[i](H);
+    }
+    H = activate(H);
+    //- residual connection around each hidden layer
+    I = residual_ ? I + H : H;
+  }
   I = output(I);
+  if(hardBC_)
+  {
+    I = applyWalls(X,I);
+  }
   return I;
 }
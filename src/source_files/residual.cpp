@@ -0,0 +1,118 @@
+#include "../include/residual.h"
+#include "../include/ch.h"
+#include <algorithm>
+#include <iomanip>
+//- construct evaluator, tile size is read from params dictionary
+residualEvaluator::residualEvaluator
+(
+  mesh2D &mesh,
+  const Dictionary &dict
+)
+:
+  mesh_(mesh),
+  tileSize_(dict.lookupOrDefault<int>("residualTile",1000)),
+  nEqn_(mesh.net_->mixed_ ? 5 : 4)
+{}
+
+//- walk through the lattice tile by tile
+void residualEvaluator::evaluate()
+{
+  //- flattened lattice, same ordering as the PDE sampling indices
+  grid_ = torch::stack
+  (
+    {
+      torch::flatten(mesh_.mesh_[0]),
+      torch::flatten(mesh_.mesh_[1]),
+      torch::flatten(mesh_.mesh_[2])
+    },1
+  );
+  const int64_t nTotal = grid_.size(0);
+  residualMap_ = torch::empty({nTotal,nEqn_},grid_.options());
+  torch::Tensor sumSq = torch::zeros({nEqn_},grid_.options());
+  torch::Tensor maxAbs = torch::zeros({nEqn_},grid_.options());
+  //- stash the current training batch, the loss functions read from the mesh
+  torch::Tensor iPDE = mesh_.iPDE_;
+  torch::Tensor fieldsPDE = mesh_.fieldsPDE_;
+  //- running statistics of batch norm, not the statistics of each tile,
+  //  and the sweep must not overwrite them
+  bool training = mesh_.net_->is_training();
+  mesh_.net_->eval();
+  for(int64_t start=0;start<nTotal;start+=tileSize_)
+  {
+    int64_t end = std::min(start + tileSize_,nTotal);
+    //- fresh leaf for each tile, gradients wrt input are needed
+    mesh_.iPDE_ = grid_.slice(0,start,end).clone();
+    mesh_.iPDE_.set_requires_grad(true);
+    mesh_.fieldsPDE_ = mesh_.net_->forward(mesh_.iPDE_);
+    //- detach so that the graph of this tile is freed at the end of the iteration
+    std::vector<torch::Tensor> residuals = 
+    {
+      CahnHillard::R_Mass2D(mesh_),
+      CahnHillard::R_MomX2d(mesh_),
+      CahnHillard::R_MomY2d(mesh_),
+      CahnHillard::R_CahnHillard2D(mesh_)
+    };
+    if(nEqn_ == 5)
+    {
+      residuals.push_back(CahnHillard::R_ChemPot2D(mesh_));
+    }
+    torch::Tensor R = torch::stack(residuals,1).detach();
+    residualMap_.slice(0,start,end).copy_(R);
+    sumSq += R.square().sum(0);
+    maxAbs = torch::maximum(maxAbs,R.abs().amax(0));
+  }
+  //- restore training batch and mode
+  mesh_.net_->train(training);
+  mesh_.iPDE_ = iPDE;
+  mesh_.fieldsPDE_ = fieldsPDE;
+  //- single transfer of the norms to host
+  torch::Tensor L2 = torch::sqrt(sumSq/nTotal).cpu();
+  torch::Tensor Linf = maxAbs.cpu();
+  L2_.assign(L2.data_ptr<float>(),L2.data_ptr<float>() + nEqn_);
+  Linf_.assign(Linf.data_ptr<float>(),Linf.data_ptr<float>() + nEqn_);
+}
+
+//- returns residual of equation eqn on the structured lattice
+torch::Tensor residualEvaluator::residualField(int eqn) const
+{
+  return residualMap_.index({Slice(),eqn}).view
+  (
+    {mesh_.Nx_,mesh_.Ny_,mesh_.Nt_}
+  );
+}
+
+//- write out the residual maps for post processing
+void residualEvaluator::write(const std::string &fileName) const
+{
+  std::ofstream outputFile(fileName);
+  if(!outputFile.is_open())
+  {
+    std::cerr << "Error: Unable to open file for writing." << std::endl;
+    return;
+  }
+  //- copy to host once and use accessors instead of item()
+  torch::Tensor data = torch::cat({grid_,residualMap_},1).cpu();
+  auto a = data.accessor<float,2>();
+  for(int64_t i=0;i<a.size(0);i++)
+  {
+    for(int64_t j=0;j<a.size(1);j++)
+    {
+      outputFile << a[i][j] << " ";
+    }
+    outputFile << "\n";
+  }
+  outputFile.close();
+}
+
+//- info out norms of the residuals
+void residualEvaluator::info() const
+{
+  const char* names[] = {"mass","momX","momY","CahnHillard","chemPot"};
+  std::cout<<"Residual over "<<grid_.size(0)<<" lattice points:\n";
+  for(int i=0;i<nEqn_;i++)
+  {
+    std::cout<<"  "<<std::setw(12)<<names[i]
+      <<" L2: "<<std::setprecision(7)<<L2_[i]
+      <<" Linf: "<<Linf_[i]<<"\n";
+  }
+}
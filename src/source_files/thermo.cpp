@@ -13,3 +13,14 @@ thermoPhysical::thermoPhysical(Dictionary &dict)
   C = 1.06066017178;
 }
 
+thermoPhysical::thermoPhysical(const thermoConfig &config)
+:
+  Mo(config.Mo),
+  epsilon(config.epsilon),
+  sigma0(config.sigma0),
+  muL(config.muL),
+  muG(config.muG),
+  rhoL(config.rhoL),
+  rhoG(config.rhoG),
+  C(1.06066017178)
+{}
@@ -0,0 +1,618 @@
+#include "../include/train.h"
+#include "../include/ch.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <cmath>
+#include <limits>
+//---------------------convergenceControl definitions-----------------------//
+
+//- constructor reads in controls from params dictionary
+convergenceControl::convergenceControl
+(
+  const Dictionary &dict
+)
+{
+  active_ = dict.lookupOrDefault<int>("convControl",0);
+  alpha_ = dict.lookupOrDefault<float>("convAlpha",0.1);
+  window_ = dict.lookupOrDefault<int>("convWindow",100);
+  minEpoch_ = dict.lookupOrDefault<int>("convMinEpoch",window_);
+  stallRate_ = dict.lookupOrDefault<float>("convStallRate",1e-3);
+  extendRate_ = dict.lookupOrDefault<float>("convExtendRate",5e-2);
+  baseBudget_ = dict.get<int>("KEPOCH");
+  maxBudget_ = dict.lookupOrDefault<int>("KEPOCHMAX",baseBudget_);
+  reset();
+}
+
+//- reset at the start of each time window
+void convergenceControl::reset()
+{
+  budget_ = baseBudget_;
+  smoothLoss_ = 0.0;
+  rate_ = 1.0;
+  ratios_.clear();
+  history_.clear();
+  stalled_ = false;
+}
+
+//- update smoothed loss, improvement rate and the epoch budget
+void convergenceControl::update
+(
+  int epoch,
+  float loss,
+  const std::vector<float> &terms
+)
+{
+  //- exponential moving average of the loss
+  smoothLoss_ = history_.empty() ? loss : alpha_*loss + (1 - alpha_)*smoothLoss_;
+  history_.push_back(smoothLoss_);
+  if(history_.size() > window_ + 1)
+  {
+    history_.pop_front();
+  }
+  //- relative improvement over the last window
+  if(history_.size() == window_ + 1)
+  {
+    rate_ = (history_.front() - smoothLoss_)/history_.front();
+  }
+  //- share of each term in the total loss
+  float total = 0.0;
+  for(float term : terms)
+  {
+    total += term;
+  }
+  ratios_.resize(terms.size());
+  for(int i=0;i<terms.size();i++)
+  {
+    ratios_[i] = total > 0 ? terms[i]/total : 0.0;
+  }
+  if(!active_)
+  {
+    return;
+  }
+  //- stagnation, stop the window early
+  if(epoch >= minEpoch_ && history_.size() == window_ + 1 && rate_ < stallRate_)
+  {
+    stalled_ = true;
+  }
+  //- budget exhausted but loss still dropping quickly, extend, the rate
+  //- is only measured once the history spans a full window
+  if
+  (
+    epoch >= budget_ && history_.size() == window_ + 1 && 
+    rate_ > extendRate_ && budget_ < maxBudget_
+  )
+  {
+    budget_ = std::min(budget_ + window_, maxBudget_);
+  }
+}
+
+//- epoch loop continues while budget left and the loss is not stagnant
+bool convergenceControl::running(int epoch) const
+{
+  return epoch <= budget_ && !stalled_;
+}
+
+//- info out
+void convergenceControl::info() const
+{
+  std::cout<<"  smoothed loss: "<<std::setprecision(7)<<smoothLoss_
+    <<" improvement rate: "<<rate_<<" budget: "<<budget_;
+  if(stalled_)
+  {
+    std::cout<<" (stalled)";
+  }
+  std::cout<<"\n  loss ratios:";
+  for(float ratio : ratios_)
+  {
+    std::cout<<" "<<ratio;
+  }
+  std::cout<<"\n";
+}
+
+//-------------------------lossBalancer definitions-------------------------//
+
+//- constructor reads in method and weights from params dictionary
+lossBalancer::lossBalancer
+(
+  const Dictionary &dict
+)
+{
+  method_ = dict.lookupOrDefault<std::string>("lossWeighting","none");
+  updateFreq_ = dict.lookupOrDefault<int>("weightUpdate",10);
+  alpha_ = dict.lookupOrDefault<float>("weightAlpha",0.1);
+  refTerm_ = CahnHillard::CH;
+  std::string refName = dict.lookupOrDefault<std::string>("weightRef","CH");
+  weights_.resize(CahnHillard::NTERMS);
+  adaptive_.resize(CahnHillard::NTERMS);
+  for(int k=0;k<CahnHillard::NTERMS;k++)
+  {
+    std::string name = CahnHillard::lossTermName(k);
+    if(name == refName)
+    {
+      refTerm_ = k;
+    }
+    //- initial (or fixed) weights, e.g wCH
+    weights_[k] = dict.lookupOrDefault<float>("w" + name,1.0);
+    //- per term switch for adaptive weights, e.g adaptCH
+    adaptive_[k] = dict.lookupOrDefault<int>("adapt" + name,1);
+  }
+  //- weight of the reference term stays fixed for annealing
+  if(method_ == "annealing")
+  {
+    adaptive_[refTerm_] = 0;
+  }
+  else if(method_ != "gradNorm" && method_ != "none")
+  {
+    std::cerr<<"Unknown lossWeighting: "<<method_<<", using fixed weights\n";
+    method_ = "none";
+  }
+}
+
+//- weights are updated every updateFreq_ epochs
+bool lossBalancer::due(int epoch) const
+{
+  return method_ != "none" && (epoch - 1) % updateFreq_ == 0;
+}
+
+//- weighted sum of the loss terms
+torch::Tensor lossBalancer::weightedLoss
+(
+  const std::vector<torch::Tensor> &terms
+) const
+{
+  torch::Tensor total = weights_[0]*terms[0];
+  for(int k=1;k<terms.size();k++)
+  {
+    total = total + weights_[k]*terms[k];
+  }
+  return total;
+}
+
+//- gradient statistics of each term and new weights
+void lossBalancer::update
+(
+  const std::vector<torch::Tensor> &terms,
+  const std::vector<torch::Tensor> &params
+)
+{
+  const int nTerms = terms.size();
+  //- max|grad|, mean|grad| and |grad|_2 for each term
+  std::vector<torch::Tensor> stats(nTerms);
+  for(int k=0;k<nTerms;k++)
+  {
+    //- terms satisfied by construction do not depend on the parameters
+    if(!terms[k].requires_grad())
+    {
+      stats[k] = torch::zeros({3},terms[k].options());
+      continue;
+    }
+    std::vector<torch::Tensor> grads = torch::autograd::grad
+    (
+      {terms[k]},
+      params,
+      {},
+      true, // retain graph for the backward pass of the total loss
+      false,
+      true // not every term depends on every parameter
+    );
+    std::vector<torch::Tensor> flat;
+    for(int i=0;i<grads.size();i++)
+    {
+      flat.push_back
+      (
+        grads[i].defined() ? grads[i].flatten() : torch::zeros_like(params[i]).flatten()
+      );
+    }
+    torch::Tensor g = torch::cat(flat).abs();
+    stats[k] = torch::stack({g.max(),g.mean(),g.norm()});
+  }
+  //- single transfer to host for all statistics
+  torch::Tensor s = torch::stack(stats).to(torch::kCPU);
+  auto a = s.accessor<float,2>();
+  const float eps = 1e-12;
+  float meanNorm = 0.0;
+  for(int k=0;k<nTerms;k++)
+  {
+    meanNorm += a[k][2]/nTerms;
+  }
+  for(int k=0;k<nTerms;k++)
+  {
+    if(!adaptive_[k] || !terms[k].requires_grad())
+    {
+      continue;
+    }
+    float target = (method_ == "annealing") ?
+      weights_[refTerm_]*a[refTerm_][0]/(a[k][1] + eps) :
+      meanNorm/(a[k][2] + eps);
+    weights_[k] = (1 - alpha_)*weights_[k] + alpha_*target;
+  }
+}
+
+//- info out
+void lossBalancer::info() const
+{
+  if(method_ == "none")
+  {
+    return;
+  }
+  std::cout<<"  loss weights ("<<method_<<"):";
+  for(int k=0;k<weights_.size();k++)
+  {
+    std::cout<<" "<<CahnHillard::lossTermName(k)<<"="<<weights_[k];
+  }
+  std::cout<<"\n";
+}
+
+//-----------------------collocationCurriculum definitions-------------------//
+
+//- constructor reads in schedule from params dictionary
+collocationCurriculum::collocationCurriculum
+(
+  const Dictionary &dict
+)
+{
+  active_ = dict.lookupOrDefault<int>("curriculum",0);
+  maxEqn_ = dict.get<int>("NEQN");
+  batchSize_ = dict.get<int>("BATCHSIZE");
+  startFraction_ = dict.lookupOrDefault<float>("curriculumStart",0.25);
+  growFactor_ = dict.lookupOrDefault<float>("curriculumGrow",2.0);
+  growEpochs_ = dict.lookupOrDefault<int>("curriculumEpochs",10);
+  stallRate_ = dict.lookupOrDefault<float>("curriculumStall",1e-2);
+  patience_ = dict.lookupOrDefault<int>("curriculumPatience",5);
+  nEqn_ = maxEqn_;
+}
+
+//- smallest budget at the start of every window
+void collocationCurriculum::reset(PinNet &net)
+{
+  nEqn_ = active_ ? startFraction_*maxEqn_ : maxEqn_;
+  lastGrowth_ = 0;
+  bestLoss_ = std::numeric_limits<float>::max();
+  sinceBest_ = 0;
+  apply(net);
+}
+
+//- grow on schedule or on a plateau of the loss
+void collocationCurriculum::update(int epoch, float loss, PinNet &net)
+{
+  if(!active_ || complete())
+  {
+    return;
+  }
+  if(loss < (1 - stallRate_)*bestLoss_)
+  {
+    bestLoss_ = loss;
+    sinceBest_ = 0;
+  }
+  else
+  {
+    sinceBest_++;
+  }
+  if(epoch - lastGrowth_ >= growEpochs_ || sinceBest_ >= patience_)
+  {
+    nEqn_ = std::min(static_cast<int>(growFactor_*nEqn_),maxEqn_);
+    lastGrowth_ = epoch;
+    bestLoss_ = std::numeric_limits<float>::max();
+    sinceBest_ = 0;
+    apply(net);
+  }
+}
+
+bool collocationCurriculum::complete() const
+{
+  return nEqn_ >= maxEqn_;
+}
+
+//- at least one batch, rounded down to whole batches
+void collocationCurriculum::apply(PinNet &net)
+{
+  nEqn_ = (nEqn_ >= maxEqn_) ? 
+    maxEqn_ : std::max(batchSize_,(nEqn_/batchSize_)*batchSize_);
+  net->N_EQN = nEqn_;
+  net->NITER_ = nEqn_/batchSize_;
+}
+
+//- info out
+void collocationCurriculum::info() const
+{
+  if(!active_)
+  {
+    return;
+  }
+  std::cout<<"  collocation points: "<<nEqn_<<"/"<<maxEqn_<<"\n";
+}
+
+//------------------------epsilonContinuation definitions--------------------//
+
+//- constructor, the initial condition targets are rebuilt with the 
+//- starting thickness
+epsilonContinuation::epsilonContinuation
+(
+  const thermoConfig &thermo,
+  mesh2D &mesh
+)
+{
+  target_ = mesh.thermo_.epsilon;
+  float start = thermo.epsilonStart;
+  factor_ = thermo.epsilonFactor;
+  active_ = start > target_;
+  if(active_)
+  {
+    mesh.thermo_.epsilon = start;
+    mesh.updateICTable();
+  }
+}
+
+//- next stage of the continuation
+bool epsilonContinuation::next(mesh2D &mesh)
+{
+  if(!active_ || mesh.thermo_.epsilon <= target_)
+  {
+    return false;
+  }
+  mesh.thermo_.epsilon = std::max(factor_*mesh.thermo_.epsilon,target_);
+  //- targets of the analytic profile follow the thickness
+  mesh.updateICTable();
+  std::cout<<"Interface thickness continuation, epsilon: "
+    <<mesh.thermo_.epsilon<<"\n";
+  return true;
+}
+
+//-------------------------fusedAdam definitions----------------------------//
+
+//- constructor, single parameter group holding the views into the buffer
+fusedAdam::fusedAdam
+(
+  PinNet &net,
+  const torch::optim::AdamOptions &options
+)
+:
+  torch::optim::Optimizer
+  (
+    {torch::optim::OptimizerParamGroup(net->parameters())},
+    std::make_unique<torch::optim::AdamOptions>(options)
+  ),
+  flat_(net->flatParameters),
+  nSteps_(0)
+{
+  grad_ = torch::zeros_like(flat_);
+  m_ = torch::zeros_like(flat_);
+  v_ = torch::zeros_like(flat_);
+}
+
+//- one Adam step on the flat buffer
+torch::Tensor fusedAdam::step(LossClosure closure)
+{
+  torch::Tensor loss;
+  if(closure)
+  {
+    loss = closure();
+  }
+  torch::NoGradGuard no_grad;
+  auto &group = param_groups()[0];
+  auto &options = static_cast<torch::optim::AdamOptions&>(group.options());
+  //- gather the gradients in one cat, unused parameters get zeros
+  std::vector<torch::Tensor> grads;
+  for(const torch::Tensor &p : group.params())
+  {
+    grads.push_back
+    (
+      p.grad().defined() ? p.grad().reshape(-1) : torch::zeros({p.numel()},flat_.options())
+    );
+  }
+  torch::cat_out(grad_,grads);
+  if(options.weight_decay() != 0)
+  {
+    grad_.add_(flat_,options.weight_decay());
+  }
+  nSteps_++;
+  const double beta1 = std::get<0>(options.betas());
+  const double beta2 = std::get<1>(options.betas());
+  const double bias1 = 1.0 - std::pow(beta1,nSteps_);
+  const double bias2 = 1.0 - std::pow(beta2,nSteps_);
+  m_.mul_(beta1).add_(grad_,1.0 - beta1);
+  v_.mul_(beta2).addcmul_(grad_,grad_,1.0 - beta2);
+  torch::Tensor denom = (v_.sqrt()/std::sqrt(bias2)).add_(options.eps());
+  //- parameters are views into flat_, this updates all of them
+  flat_.addcdiv_(m_,denom,-options.lr()/bias1);
+  return loss;
+}
+
+//- fused Adam on the flat buffer, torch Adam otherwise
+std::unique_ptr<torch::optim::Optimizer> makeAdam(PinNet &net, float lr)
+{
+  if(net->flatParameters.defined())
+  {
+    return std::make_unique<fusedAdam>(net,torch::optim::AdamOptions(lr));
+  }
+  return std::make_unique<torch::optim::Adam>
+  (
+    net->parameters(),
+    torch::optim::AdamOptions(lr)
+  );
+}
+
+//-------------------------levenbergMarquardt definitions-------------------//
+
+//- constructor reads in damping controls from params dictionary
+levenbergMarquardt::levenbergMarquardt
+(
+  const Dictionary &dict
+)
+{
+  active_ = dict.lookupOrDefault<std::string>("optimizer","adam") == "lm";
+  lambda0_ = dict.lookupOrDefault<float>("lmLambda",1e-3);
+  lambda_ = lambda0_;
+  up_ = dict.lookupOrDefault<float>("lmUp",10.0);
+  down_ = dict.lookupOrDefault<float>("lmDown",0.1);
+  maxTries_ = dict.lookupOrDefault<int>("lmTries",5);
+}
+
+//- reset damping at the start of a window
+void levenbergMarquardt::reset()
+{
+  lambda_ = lambda0_;
+}
+
+//- Jacobian from J^T u with a dummy u, every column is one backward pass
+torch::Tensor levenbergMarquardt::jacobian
+(
+  const torch::Tensor &r,
+  const std::vector<torch::Tensor> &params
+) const
+{
+  torch::Tensor u = torch::zeros_like(r).requires_grad_(true);
+  std::vector<torch::Tensor> JTu = torch::autograd::grad
+  (
+    {r},
+    params,
+    {u},
+    true, // retain graph of r for the columns
+    true, // J^T u has to be differentiable wrt u
+    true
+  );
+  std::vector<torch::Tensor> flat;
+  for(int i=0;i<params.size();i++)
+  {
+    flat.push_back
+    (
+      JTu[i].defined() ? JTu[i].flatten() : torch::zeros({params[i].numel()},r.options())
+    );
+  }
+  torch::Tensor g = torch::cat(flat);
+  std::vector<torch::Tensor> columns;
+  columns.reserve(g.numel());
+  for(int64_t j=0;j<g.numel();j++)
+  {
+    torch::Tensor column;
+    if(g[j].requires_grad())
+    {
+      column = torch::autograd::grad({g[j]},{u},{},true,false,true)[0];
+    }
+    columns.push_back(column.defined() ? column : torch::zeros_like(r));
+  }
+  return torch::stack(columns,1).detach();
+}
+
+//- parameters += delta, delta is laid out as the concatenated parameters
+void levenbergMarquardt::addStep
+(
+  const std::vector<torch::Tensor> &params,
+  const torch::Tensor &delta
+) const
+{
+  torch::NoGradGuard no_grad;
+  int64_t offset = 0;
+  for(const torch::Tensor &p : params)
+  {
+    const_cast<torch::Tensor&>(p).add_
+    (
+      delta.slice(0,offset,offset + p.numel()).view_as(p)
+    );
+    offset += p.numel();
+  }
+}
+
+//- damped Gauss-Newton step on the first batch
+std::vector<torch::Tensor> levenbergMarquardt::step(mesh2D &mesh)
+{
+  mesh.update(0);
+  std::vector<torch::Tensor> params = mesh.net_->parameters();
+  torch::Tensor r = CahnHillard::residualVector(mesh);
+  torch::Tensor J = jacobian(r,params);
+  r = r.detach();
+  torch::Tensor JTJ = torch::mm(J.t(),J);
+  torch::Tensor JTr = torch::mv(J.t(),r);
+  torch::Tensor D = torch::diag(torch::diag(JTJ).clamp_min(1e-12));
+  float loss = r.square().sum().item<float>();
+  for(int k=0;k<maxTries_;k++)
+  {
+    torch::Tensor delta = torch::linalg_solve(JTJ + lambda_*D,-JTr);
+    addStep(params,delta);
+    mesh.forward();
+    float trial = CahnHillard::residualVector(mesh).square().sum().item<float>();
+    if(trial < loss)
+    {
+      lambda_ = std::max(lambda_*down_,1e-12f);
+      break;
+    }
+    //- reject, back to the old parameters with more damping, bounded so
+    //- that repeated rejections do not overflow the normal equations
+    addStep(params,-delta);
+    lambda_ = std::min(lambda_*up_,1e12f);
+  }
+  //- loss terms of the current state for the controllers and the log
+  mesh.forward();
+  std::vector<torch::Tensor> terms = CahnHillard::lossTerms(mesh);
+  for(torch::Tensor &term : terms)
+  {
+    term = term.detach();
+  }
+  return terms;
+}
+
+//-------------------------timeMarching definitions-------------------------//
+
+//- constructor reads in controls from mesh dictionary
+timeMarching::timeMarching
+(
+  const Dictionary &dict,
+  const mesh2D &mesh
+)
+{
+  adaptive_ = dict.lookupOrDefault<int>("adaptiveStep",0);
+  step_ = mesh.TimeStep_;
+  //- three windows unless specified otherwise
+  endTime_ = dict.lookupOrDefault<float>("endTime",mesh.lbT_ + 3*step_);
+  minStep_ = dict.lookupOrDefault<float>("minStep",0.1*step_);
+  maxStep_ = dict.lookupOrDefault<float>("maxStep",step_);
+  growFactor_ = dict.lookupOrDefault<float>("growFactor",1.5);
+  shrinkFactor_ = dict.lookupOrDefault<float>("shrinkFactor",0.5);
+  fastFraction_ = dict.lookupOrDefault<float>("fastFraction",0.5);
+  icTol_ = dict.lookupOrDefault<float>("icTol",1e-2);
+}
+
+//- keep marching until the end time is reached
+bool timeMarching::running(const mesh2D &mesh) const
+{
+  return mesh.lbT_ < endTime_ - 0.5*mesh.deltaT_;
+}
+
+//- accept or reject the trained window and update the step
+bool timeMarching::accept
+(
+  bool converged,
+  int epochs,
+  int budget,
+  float icLoss
+)
+{
+  if(!adaptive_)
+  {
+    return true;
+  }
+  //- window too long, shrink and retry unless already at minimum step
+  if((!converged || icLoss > icTol_) && step_ > minStep_)
+  {
+    step_ = std::max(step_*shrinkFactor_, minStep_);
+    return false;
+  }
+  //- window converged quickly, grow the next one
+  if(converged && epochs <= fastFraction_*budget)
+  {
+    step_ = std::min(step_*growFactor_, maxStep_);
+  }
+  return true;
+}
+
+//- move mesh to the next window, not past the end time
+void timeMarching::advance(mesh2D &mesh) const
+{
+  if(!adaptive_)
+  {
+    mesh.updateMesh();
+    return;
+  }
+  mesh.advanceWindow(std::min(step_, endTime_ - mesh.ubT_));
+}
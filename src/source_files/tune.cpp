@@ -0,0 +1,202 @@
+#include "../include/tune.h"
+#include "../include/pinn.h"
+#include "../include/mesh.h"
+#include "../include/ch.h"
+#include "../include/train.h"
+#include "../include/thermo.h"
+#include "../include/allocator.h"
+#include <ATen/CPUGeneratorImpl.h>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <vector>
+//- one configuration of the tuner and its measurements
+struct tuneCandidate
+{
+  int batch;
+  int threads;
+  double pointsPerSec = 0.0;
+  size_t peak = 0;
+};
+
+//- key of a record, hardware and everything that sets the cost of a step
+static std::string tuneKey(const caseConfig &config, const torch::Device &device)
+{
+  const Dictionary &net = config.net;
+  std::stringstream key;
+  key<<(device.is_cuda() ? "cuda" : "cpu")
+    <<"-"<<std::thread::hardware_concurrency()
+    <<"-"<<net.get<int>("hiddenLayerDim")<<"x"<<net.get<int>("nHiddenLayer")
+    <<"x"<<net.get<int>("outputDim")
+    <<"-"<<net.get<int>("NEQN")
+    <<"-"<<net.get<std::string>("activation")
+    <<"-"<<net.get<std::string>("normalization")
+    <<"-ff"<<net.get<int>("fourierFeatures")
+    <<"-mixed"<<net.get<int>("mixed")
+    <<"-fd:"<<net.get<std::string>("fdTerms")
+    <<"-"<<config.runtime_.memoryBudgetMB;
+  return key.str();
+}
+
+//- apply a choice to the net section and the thread pool
+static void applyChoice(caseConfig &config, int batch, int threads)
+{
+  config.net.set("BATCHSIZE",std::to_string(batch));
+  at::set_num_threads(threads);
+}
+
+//- time a few epochs of the batch loop with the given batch size
+static void runTrial
+(
+  const caseConfig &config,
+  torch::Device &device,
+  tuneCandidate &candidate
+)
+{
+  //- nets keep a reference to the Dictionary, keep it alive in this scope
+  Dictionary netDict = config.net;
+  Dictionary meshDict = config.mesh;
+  netDict.set("BATCHSIZE",std::to_string(candidate.batch));
+  at::set_num_threads(candidate.threads);
+  thermoPhysical thermo(config.thermo_);
+  torch::manual_seed(0);
+  auto net1 = PinNet(netDict);
+  auto net2 = PinNet(netDict);
+  net1->to(device);
+  net2->to(device);
+  mesh2D mesh(meshDict,net1,net2,device,thermo);
+  auto optim = makeAdam(mesh.net_,config.optim_.lRate);
+  const int nIter = mesh.net_->NITER_;
+  //- one epoch with the cadence of the closure in main, gradients of all
+  //- batches are accumulated and the optimizer steps once
+  auto epoch = [&]()
+  {
+    torch::Tensor total;
+    for(int i=0;i<nIter;i++)
+    {
+      mesh.update(i);
+      torch::Tensor loss = CahnHillard::loss(mesh);
+      loss.backward();
+      total = (i == 0) ? loss.detach() : total + loss.detach();
+    }
+    optim->step();
+    optim->zero_grad();
+    return total;
+  };
+  //- warm up, first epoch allocates the buffers
+  epoch();
+  cachingCPUAllocator *allocator = cachingCPUAllocator::instance();
+  if(allocator)
+  {
+    allocator->resetPeak();
+  }
+  const int nSteps = config.runtime_.autoTuneSteps;
+  torch::Tensor loss;
+  auto start_time = std::chrono::high_resolution_clock::now();
+  for(int i=0;i<nSteps;i++)
+  {
+    loss = epoch();
+  }
+  //- item() waits for the device to finish
+  loss.item<float>();
+  auto end_time = std::chrono::high_resolution_clock::now();
+  double seconds = std::chrono::duration<double>(end_time - start_time).count();
+  candidate.pointsPerSec = double(candidate.batch)*nIter*nSteps/seconds;
+  candidate.peak = allocator ? allocator->peak() : 0;
+}
+
+void autoTune
+(
+  caseConfig &config,
+  torch::Device &device
+)
+{
+  const runtimeConfig &runtime = config.runtime_;
+  const std::string key = tuneKey(config,device);
+  //- reuse a recorded choice for the same hardware and case
+  {
+    std::ifstream record(runtime.autoTuneFile);
+    std::string line;
+    while(std::getline(record,line))
+    {
+      std::stringstream ss(line);
+      std::string recordKey;
+      int batch, threads;
+      if((ss>>recordKey>>batch>>threads) && recordKey == key)
+      {
+        std::cout<<"Auto-tune: reusing BATCHSIZE "<<batch<<", threads "
+          <<threads<<" from "<<runtime.autoTuneFile<<"\n";
+        applyChoice(config,batch,threads);
+        return;
+      }
+    }
+  }
+  const int nEqn = config.net.get<int>("NEQN");
+  const size_t budget = size_t(runtime.memoryBudgetMB) << 20;
+  //- peak memory is only known to the arena allocator, which is CPU only
+  if(budget > 0 && !cachingCPUAllocator::instance())
+  {
+    std::cerr<<"Auto-tune: memoryBudgetMB needs arenaAllocator 1 on the CPU\n";
+    std::exit(EXIT_FAILURE);
+  }
+  //- trials seed and draw from the global generator, the run must get the
+  //- same random stream whether or not a record was reused
+  at::Generator generator = at::detail::getDefaultCPUGenerator();
+  torch::Tensor rngState = generator.get_state();
+  //- batch sizes dividing NEQN, threads from all cores down to a quarter
+  std::vector<int> batches;
+  for(int k : {1,2,4,8,16,32})
+  {
+    if(nEqn % k == 0)
+    {
+      batches.push_back(nEqn/k);
+    }
+  }
+  std::vector<int> threads = {at::get_num_threads()};
+  if(!device.is_cuda())
+  {
+    for(int t : {threads[0]/2,threads[0]/4})
+    {
+      if(t >= 1 && t != threads.back())
+      {
+        threads.push_back(t);
+      }
+    }
+  }
+  std::cout<<"Auto-tuning BATCHSIZE and threads, "<<runtime.autoTuneSteps<<" steps each...\n";
+  std::cout<<std::setw(12)<<"batch"<<std::setw(10)<<"threads"
+    <<std::setw(16)<<"points/s"<<std::setw(12)<<"peak MB"<<"\n";
+  tuneCandidate best{0,threads[0]};
+  for(int batch : batches)
+  {
+    for(int t : threads)
+    {
+      tuneCandidate candidate{batch,t};
+      runTrial(config,device,candidate);
+      bool fits = budget == 0 || candidate.peak <= budget;
+      std::cout<<std::setw(12)<<batch<<std::setw(10)<<t
+        <<std::setw(16)<<std::setprecision(6)<<candidate.pointsPerSec
+        <<std::setw(12)<<(candidate.peak >> 20)<<(fits ? "" : "  over budget")<<"\n";
+      if(fits && candidate.pointsPerSec > best.pointsPerSec)
+      {
+        best = candidate;
+      }
+    }
+  }
+  //- nothing fits, smallest batch is the best we can do
+  if(best.batch == 0)
+  {
+    best.batch = batches.back();
+    std::cout<<"Auto-tune: no candidate within the budget\n";
+  }
+  generator.set_state(rngState);
+  std::cout<<"Auto-tune: BATCHSIZE "<<best.batch
+    <<", threads "<<best.threads<<"\n";
+  applyChoice(config,best.batch,best.threads);
+  std::ofstream record(runtime.autoTuneFile,std::ios::app);
+  record<<key<<" "<<best.batch<<" "<<best.threads<<" "
+    <<best.pointsPerSec<<" "<<(best.peak >> 20)<<"\n";
+}